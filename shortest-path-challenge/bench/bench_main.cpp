@@ -0,0 +1,768 @@
+#include "course_generator.h"
+#include "geodesic.h"
+#include "json_parser.h"
+#include "k_shortest_paths.h"
+#include "metrics.h"
+#include "path_validator.h"
+#include "route_service.h"
+#include "shortest_path.h"
+#include "windowed_solver.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <thread>
+#include <nlohmann/json.hpp>
+using namespace marine_nav;
+using json = nlohmann::json;
+
+// Every operator new in the process is counted, so each stage can report the heap allocations of a run.
+// All the replaceable forms are replaced together (plain, array, aligned and nothrow new, and every
+// matching delete), so every pointer is freed by the allocator that produced it.
+static std::atomic<size_t> allocation_count(0);
+
+static void* counted_allocate(std::size_t size, std::size_t alignment, bool nothrow)
+{
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    size = size ? size : 1;
+    // aligned_alloc needs a size that is a multiple of the alignment.
+    void* memory = alignment <= alignof(std::max_align_t) ? std::malloc(size) 
+                                                          : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (!memory && !nothrow)
+    {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+void* operator new(std::size_t size)
+{
+    return counted_allocate(size, 0, false);
+}
+
+void* operator new[](std::size_t size)
+{
+    return counted_allocate(size, 0, false);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+    return counted_allocate(size, static_cast<std::size_t>(alignment), false);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return counted_allocate(size, static_cast<std::size_t>(alignment), false);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_allocate(size, 0, true);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept
+{
+    return counted_allocate(size, 0, true);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return counted_allocate(size, static_cast<std::size_t>(alignment), true);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+    return counted_allocate(size, static_cast<std::size_t>(alignment), true);
+}
+
+void operator delete(void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept
+{
+    std::free(memory);
+}
+
+struct BenchOptions
+{
+    std::vector<size_t> sizes = {10, 100, 1000, 10000, 100000};
+    std::vector<CourseShape> shapes = {CourseShape::ZigZag, CourseShape::Spiral, CourseShape::Harbour, CourseShape::OpenSea};
+    size_t repeat = 3;
+    double budget_seconds = 30.0;
+    size_t thread_count = 1;
+    uint64_t seed = 1;
+    bool spatial_index = true;
+    std::vector<size_t> alternatives = {1, 2, 5, 10};
+    std::string output_file = "bench_results.json";
+};
+
+// Timings of one stage at one size, in milliseconds.
+struct StageResult
+{
+    bool ran = false;
+    std::string skip_reason;
+    std::vector<double> runs;
+    json details = json::object();
+    double min_ms() const
+    {
+        return runs.empty() ? 0.0 : *std::min_element(runs.begin(), runs.end());
+    }
+    double median_ms() const
+    {
+        std::vector<double> sorted = runs;
+        std::sort(sorted.begin(), sorted.end());
+        return sorted.empty() ? 0.0 : sorted[sorted.size() / 2];
+    }
+};
+
+// Last completed size and time of a stage, used to project whether the next size fits the budget.
+struct StageHistory
+{
+    size_t size = 0;
+    double seconds = 0.0;
+};
+
+void print_usage(const char* program_name)
+{
+    std::cout << "Usage: " << program_name << " [options]\n";
+    std::cout << "       " << program_name << " --emit <shape> <segments> <course.json>\n";
+    std::cout << "Times JSON parsing, build_graph, solve, validate_path and edge weights on generated gateway courses.\n";
+    std::cout << "Options:\n";
+    std::cout << "  --sizes <n,n,...>                          - Segment counts (default: 10,100,1000,10000,100000)\n";
+    std::cout << "  --shapes <zigzag,spiral,harbour,opensea>   - Course shapes (default: all)\n";
+    std::cout << "  --repeat <n>                               - Runs per stage; the median and minimum are reported (default: 3)\n";
+    std::cout << "  --budget <seconds>                         - Skip a stage once its projected run time exceeds this (default: 30)\n";
+    std::cout << "  --threads <n>                              - Graph construction threads, 0 = all cores (default: 1)\n";
+    std::cout << "  --seed <n>                                 - Generator seed (default: 1)\n";
+    std::cout << "  --no-spatial-index                         - Scan every segment instead of querying the R-tree\n";
+    std::cout << "  --alternatives <k,k,...>                   - Route counts for the k_paths stages over the built graph (default: 1,2,5,10)\n";
+    std::cout << "  --output <results.json>                    - Machine-readable results (default: bench_results.json)\n";
+}
+
+std::vector<std::string> split_list(const std::string& text)
+{
+    std::vector<std::string> items;
+    std::stringstream stream(text);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        if (!item.empty())
+        {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+// Generated courses always have a route (see CourseGenerator), so a stage that finds none has failed.
+void require(bool condition, const std::string& stage, const std::string& what)
+{
+    if (!condition)
+    {
+        throw std::runtime_error(stage + ": " + what + " on a generated course");
+    }
+}
+
+// Runs body up to repeat times; a run longer than the budget is not repeated.
+StageResult time_stage(size_t repeat, double budget_seconds, const std::function<void(StageResult&)>& body)
+{
+    StageResult result;
+    result.ran = true;
+    for (size_t run = 0; run < repeat; ++run)
+    {
+        size_t allocations = allocation_count.load(std::memory_order_relaxed);
+        auto start = std::chrono::steady_clock::now();
+        body(result);
+        auto end = std::chrono::steady_clock::now();
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        result.runs.push_back(ms);
+        result.details["allocations"] = allocation_count.load(std::memory_order_relaxed) - allocations;
+        if (ms / 1000.0 > budget_seconds)
+        {
+            break;
+        }
+    }
+    return result;
+}
+
+// Parse is linear in the input; the graph build, the solve (worst case) and validation are quadratic.
+double stage_exponent(const std::string& stage)
+{
+    return stage == "parse" ? 1.0 : 2.0;
+}
+
+bool fits_budget(const std::map<std::string, StageHistory>& history, const std::string& stage, size_t size, double budget_seconds, std::string& reason)
+{
+    auto it = history.find(stage);
+    if (it == history.end() || it->second.size == 0)
+    {
+        return true;
+    }
+    double projected = it->second.seconds * std::pow(static_cast<double>(size) / it->second.size, stage_exponent(stage));
+    if (projected <= budget_seconds)
+    {
+        return true;
+    }
+    char buffer[96];
+    std::snprintf(buffer, sizeof(buffer), "projected %.1f s exceeds the %.1f s budget", projected, budget_seconds);
+    reason = buffer;
+    return false;
+}
+
+json stage_to_json(const std::string& shape, size_t size, const std::string& stage, const StageResult& result)
+{
+    json entry;
+    entry["shape"] = shape;
+    entry["segments"] = size;
+    entry["stage"] = stage;
+    if (!result.ran)
+    {
+        entry["status"] = "skipped";
+        entry["reason"] = result.skip_reason;
+        return entry;
+    }
+    entry["status"] = "ok";
+    entry["runs_ms"] = result.runs;
+    entry["min_ms"] = result.min_ms();
+    entry["median_ms"] = result.median_ms();
+    for (auto it = result.details.begin(); it != result.details.end(); ++it)
+    {
+        entry[it.key()] = it.value();
+    }
+    return entry;
+}
+
+int run_emit(const std::string& shape_name, const std::string& count, const std::string& output_file, uint64_t seed)
+{
+    CourseShape shape;
+    if (!CourseGenerator::parse_shape(shape_name, shape))
+    {
+        std::cerr << "Unknown course shape: " << shape_name << "\n";
+        return 1;
+    }
+    GeneratedCourse course = CourseGenerator::generate(shape, std::stoul(count), seed);
+    std::ofstream file(output_file);
+    if (!file.is_open())
+    {
+        std::cerr << "Error: Could not create output file: " << output_file << "\n";
+        return 1;
+    }
+    file << CourseGenerator::to_json(course);
+    std::cout << "Wrote " << course.segments.size() << " " << shape_name << " gateways to " << output_file << "\n";
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    std::vector<std::string> emit;
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--emit") == 0 && i + 3 < argc)
+        {
+            emit.assign(argv + i + 1, argv + i + 4);
+            i += 3;
+        }
+        else if (std::strcmp(argv[i], "--sizes") == 0 && i + 1 < argc)
+        {
+            options.sizes.clear();
+            for (const auto& item : split_list(argv[++i]))
+            {
+                options.sizes.push_back(std::stoul(item));
+            }
+        }
+        else if (std::strcmp(argv[i], "--alternatives") == 0 && i + 1 < argc)
+        {
+            options.alternatives.clear();
+            for (const auto& item : split_list(argv[++i]))
+            {
+                options.alternatives.push_back(std::stoul(item));
+            }
+        }
+        else if (std::strcmp(argv[i], "--shapes") == 0 && i + 1 < argc)
+        {
+            options.shapes.clear();
+            for (const auto& item : split_list(argv[++i]))
+            {
+                CourseShape shape;
+                if (!CourseGenerator::parse_shape(item, shape))
+                {
+                    std::cerr << "Unknown course shape: " << item << "\n";
+                    return 1;
+                }
+                options.shapes.push_back(shape);
+            }
+        }
+        else if (std::strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            options.repeat = std::max<size_t>(1, std::stoul(argv[++i]));
+        }
+        else if (std::strcmp(argv[i], "--budget") == 0 && i + 1 < argc)
+        {
+            options.budget_seconds = std::stod(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+        {
+            options.thread_count = std::stoul(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--seed") == 0 && i + 1 < argc)
+        {
+            options.seed = std::stoull(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc)
+        {
+            options.output_file = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--no-spatial-index") == 0)
+        {
+            options.spatial_index = false;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    std::sort(options.sizes.begin(), options.sizes.end());
+    try
+    {
+        if (!emit.empty())
+        {
+            return run_emit(emit[0], emit[1], emit[2], options.seed);
+        }
+        json report;
+        GeometryEngine probe;
+        report["machine"] = {
+            {"hardware_threads", std::thread::hardware_concurrency()},
+            {"simd_level", IntersectionKernel::simd_level_name(probe.get_simd_level())}
+        };
+        report["config"] = {
+            {"repeat", options.repeat},
+            {"budget_seconds", options.budget_seconds},
+            {"threads", options.thread_count},
+            {"seed", options.seed},
+            {"spatial_index", options.spatial_index}
+        };
+        report["results"] = json::array();
+        std::printf("%-8s %8s %-12s %12s %12s  %s\n", "shape", "segments", "stage", "median ms", "min ms", "notes");
+        for (CourseShape shape : options.shapes)
+        {
+            const std::string shape_name = CourseGenerator::shape_name(shape);
+            std::map<std::string, StageHistory> history;
+            for (size_t size : options.sizes)
+            {
+                GeneratedCourse course = CourseGenerator::generate(shape, size, options.seed);
+                std::string input = CourseGenerator::to_json(course);
+                std::vector<std::pair<std::string, StageResult>> stages;
+                auto run = [&](const std::string& stage, const std::function<void(StageResult&)>& body)
+                {
+                    StageResult result;
+                    if (fits_budget(history, stage, size, options.budget_seconds, result.skip_reason))
+                    {
+                        result = time_stage(options.repeat, options.budget_seconds, body);
+                        history[stage] = StageHistory{size, result.min_ms() / 1000.0};
+                    }
+                    stages.emplace_back(stage, result);
+                };
+                run("parse", [&](StageResult& result)
+                {
+                    InputData parsed = JsonParser::parse_input_string(input);
+                    if (parsed.segments.size() != course.segments.size())
+                    {
+                        throw std::runtime_error("Generated course did not round-trip through the parser");
+                    }
+                    result.details["bytes"] = input.size();
+                });
+                std::vector<size_t> fused_offsets;
+                std::vector<int> fused_targets;
+                std::unique_ptr<VisibilityGraph> built;
+                run("build", [&](StageResult& result)
+                {
+                    std::unique_ptr<VisibilityGraph> graph(new VisibilityGraph());
+                    graph->set_thread_count(options.thread_count);
+                    graph->get_geometry_engine().set_spatial_index(options.spatial_index);
+                    uint64_t exact_before = Metrics::get(Counter::ExactOrientations);
+                    graph->build_graph(course.segments, course.start, course.end);
+                    require(graph->get_edge_count() > 0, "build", "no edges");
+                    result.details["edges"] = graph->get_edge_count();
+                    result.details["pairs_evaluated"] = graph->get_pairs_evaluated();
+                    result.details["exact_orientations"] = Metrics::get(Counter::ExactOrientations) - exact_before;
+                    fused_offsets.assign(graph->get_row_offsets(), graph->get_row_offsets() + graph->get_node_count() + 1);
+                    fused_targets.assign(graph->get_row_targets(), graph->get_row_targets() + graph->get_row_entry_count());
+                    built = std::move(graph);
+                });
+                // Yen's K shortest routes over the graph the build stage left behind, so only the route
+                // search is timed; k_paths_1 is the plain shortest path through the same code.
+                for (size_t k : options.alternatives)
+                {
+                    if (!built)
+                    {
+                        break;
+                    }
+                    run("k_paths_" + std::to_string(k), [&](StageResult& result)
+                    {
+                        KShortestPaths finder(*built);
+                        std::vector<PathResult> routes = finder.find(built->find_node_index(course.start.label_id), 
+                                                                     built->find_node_index(course.end.label_id), k);
+                        require(!routes.empty(), "k_paths", "no route");
+                        result.details["routes"] = routes.size();
+                        if (!routes.empty())
+                        {
+                            result.details["longest_distance"] = routes.back().total_distance;
+                        }
+                        result.details["spur_searches"] = finder.get_spur_searches();
+                        result.details["nodes_settled"] = finder.get_nodes_settled();
+                    });
+                }
+                // The pre-fusion pipeline on the same course: its time against "build" is the fused
+                // evaluator's speedup, and its rows must match the fused build's exactly.
+                run("build_staged", [&](StageResult& result)
+                {
+                    VisibilityGraph graph;
+                    graph.set_fused_constraints(false);
+                    graph.set_thread_count(options.thread_count);
+                    graph.get_geometry_engine().set_spatial_index(options.spatial_index);
+                    graph.build_graph(course.segments, course.start, course.end);
+                    require(graph.get_edge_count() > 0, "build_staged", "no edges");
+                    result.details["edges"] = graph.get_edge_count();
+                    if (!fused_offsets.empty())
+                    {
+                        const size_t* offsets = graph.get_row_offsets();
+                        const int* targets = graph.get_row_targets();
+                        if (!std::equal(fused_offsets.begin(), fused_offsets.end(), offsets) 
+                            || !std::equal(fused_targets.begin(), fused_targets.end(), targets))
+                        {
+                            throw std::runtime_error("Fused and staged constraint checks built different graphs");
+                        }
+                        result.details["matches_fused"] = true;
+                    }
+                });
+                // Lazy rows keep the solve to the pairs the search touches, so it is measured apart from
+                // the full build above.
+                double solve_distance = std::numeric_limits<double>::quiet_NaN();
+                run("solve", [&](StageResult& result)
+                {
+                    ShortestPathSolver solver;
+                    solver.set_lazy_graph(true);
+                    solver.get_graph().get_geometry_engine().set_spatial_index(options.spatial_index);
+                    PathResult path = solver.solve(course.segments, course.start, course.end);
+                    require(path.found, "solve", "no route");
+                    solve_distance = path.total_distance;
+                    result.details["found"] = path.found;
+                    result.details["distance"] = path.total_distance;
+                    result.details["nodes_settled"] = path.nodes_settled;
+                    result.details["pairs_evaluated"] = solver.get_graph().get_pairs_evaluated();
+                });
+                // The layered sweep searches the same forward edges as Dijkstra, so it must find the same distance.
+                run("layered", [&](StageResult& result)
+                {
+                    ShortestPathSolver solver;
+                    solver.set_search_algorithm(SearchAlgorithm::LayeredDag);
+                    solver.get_graph().get_geometry_engine().set_spatial_index(options.spatial_index);
+                    PathResult path = solver.solve(course.segments, course.start, course.end);
+                    require(path.found, "layered", "no route");
+                    require(std::isnan(solve_distance) || std::fabs(path.total_distance - solve_distance) <= 1e-9 * std::max(1.0, solve_distance),
+                            "layered", "a different distance from Dijkstra");
+                    result.details["distance"] = path.total_distance;
+                    result.details["nodes_settled"] = path.nodes_settled;
+                    result.details["pairs_evaluated"] = solver.get_graph().get_pairs_evaluated();
+                });
+                // One solver kept across runs: after the first run its workspace and graph scratch are warm,
+                // so the allocation count is what a batch pays per repeated solve.
+                ShortestPathSolver warm_solver;
+                warm_solver.set_lazy_graph(true);
+                warm_solver.get_graph().get_geometry_engine().set_spatial_index(options.spatial_index);
+                run("solve_warm", [&](StageResult& result)
+                {
+                    PathResult path = warm_solver.solve(course.segments, course.start, course.end);
+                    require(path.found, "solve_warm", "no route");
+                    result.details["found"] = path.found;
+                    result.details["nodes_settled"] = path.nodes_settled;
+                });
+                // The same course cut into 64-gateway windows overlapping by 8, tabulated on the build's threads.
+                // Its distance against "solve" shows what the window bound gives up, if anything.
+                run("windowed", [&](StageResult& result)
+                {
+                    ShortestPathSolver solver;
+                    solver.set_search_algorithm(SearchAlgorithm::Windowed);
+                    solver.set_window(64, 8);
+                    solver.get_graph().set_thread_count(options.thread_count);
+                    solver.get_graph().get_geometry_engine().set_spatial_index(options.spatial_index);
+                    PathResult path = solver.solve(course.segments, course.start, course.end);
+                    require(path.found, "windowed", "no route");
+                    result.details["found"] = path.found;
+                    result.details["distance"] = path.total_distance;
+                    result.details["error_bound"] = solver.get_windowed_solver()->get_error_bound();
+                    result.details["nodes_settled"] = path.nodes_settled;
+                });
+                // A fleet of 16 vessels to 16 destinations, spread along the first and last legs of the
+                // centre line. The gateway graph is built once, outside the timed matrix.
+                RouteService fleet_service;
+                std::vector<Point> fleet_starts;
+                std::vector<Point> fleet_ends;
+                for (size_t i = 0; i < 16; ++i)
+                {
+                    double t = i / 16.0;
+                    const std::vector<Point>& line = course.centre_line;
+                    const Point& a = line[0];
+                    const Point& b = line[1];
+                    const Point& c = line[line.size() - 2];
+                    const Point& d = line.back();
+                    fleet_starts.emplace_back(a.label_id, a.x + (b.x - a.x) * t * 0.5, a.y + (b.y - a.y) * t * 0.5);
+                    fleet_ends.emplace_back(d.label_id, d.x + (c.x - d.x) * t * 0.5, d.y + (c.y - d.y) * t * 0.5);
+                }
+                run("route_matrix", [&](StageResult& result)
+                {
+                    if (!fleet_service.is_loaded())
+                    {
+                        fleet_service.set_thread_count(options.thread_count);
+                        fleet_service.get_geometry_engine().set_spatial_index(options.spatial_index);
+                        fleet_service.load(course.segments);
+                    }
+                    auto started = std::chrono::steady_clock::now();
+                    RouteMatrix matrix = fleet_service.route_matrix(fleet_starts, fleet_ends);
+                    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+                    size_t routed = std::count_if(matrix.costs.begin(), matrix.costs.end(), [](double cost) { return std::isfinite(cost); });
+                    require(routed == matrix.costs.size(), "route_matrix", "an unrouted fleet pair");
+                    result.details["pairs"] = matrix.costs.size();
+                    result.details["routed"] = routed;
+                    result.details["matrix_ms"] = seconds * 1000.0;
+                });
+                // The course's centre line runs along the direct route through every crossing point, so every
+                // gateway is checked against every leg.
+                run("validate", [&](StageResult& result)
+                {
+                    ShortestPathSolver solver;
+                    bool valid = solver.validate_path(course.centre_line, course.segments, course.start, course.end);
+                    require(valid, "validate", "a rejected centre line");
+                    result.details["valid"] = valid;
+                    result.details["path_points"] = course.centre_line.size();
+                });
+                // The oracle's triangle needs 4 S² doubles, so large courses skip it instead of exhausting memory.
+                const size_t oracle_max_segments = 2000;
+                auto run_oracle = [&](const std::string& stage, const std::function<void(StageResult&)>& body)
+                {
+                    if (size > oracle_max_segments)
+                    {
+                        StageResult result;
+                        result.skip_reason = "oracle limited to " + std::to_string(oracle_max_segments) + " segments";
+                        stages.emplace_back(stage, result);
+                        return;
+                    }
+                    run(stage, body);
+                };
+                run_oracle("oracle_build", [&](StageResult& result)
+                {
+                    if (!fleet_service.is_loaded())
+                    {
+                        fleet_service.set_thread_count(options.thread_count);
+                        fleet_service.get_geometry_engine().set_spatial_index(options.spatial_index);
+                        fleet_service.load(course.segments);
+                    }
+                    fleet_service.build_oracle();
+                    result.details["entries"] = fleet_service.get_oracle().get_entry_count();
+                    result.details["megabytes"] = fleet_service.get_oracle().get_entry_count() * sizeof(double) / (1024.0 * 1024.0);
+                });
+                run_oracle("oracle_query", [&](StageResult& result)
+                {
+                    if (!fleet_service.get_oracle().is_ready())
+                    {
+                        throw std::runtime_error("oracle_build did not run");
+                    }
+                    size_t routed = 0;
+                    auto started = std::chrono::steady_clock::now();
+                    for (const Point& start : fleet_starts)
+                    {
+                        for (const Point& end : fleet_ends)
+                        {
+                            routed += std::isfinite(fleet_service.route_distance(start, end)) ? 1 : 0;
+                        }
+                    }
+                    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+                    size_t queries = fleet_starts.size() * fleet_ends.size();
+                    require(routed == queries, "oracle_query", "an unrouted fleet pair");
+                    // The first start's row, outside the timing, against full searches.
+                    for (const Point& end : fleet_ends)
+                    {
+                        double expected = fleet_service.route(fleet_starts.front(), end).total_distance;
+                        require(std::fabs(fleet_service.route_distance(fleet_starts.front(), end) - expected) <= 1e-9 * std::max(1.0, expected),
+                                "oracle_query", "a different distance from route");
+                    }
+                    result.details["queries"] = queries;
+                    result.details["routed"] = routed;
+                    result.details["us_per_query"] = seconds * 1e6 / queries;
+                });
+                // An audit of many dispatched routes: the validator is prepared once, then copies of the
+                // centre line are checked on the bench's threads.
+                PathValidator validator;
+                validator.set_thread_count(options.thread_count);
+                validator.prepare(course.segments);
+                std::vector<std::vector<Point>> audit(64, course.centre_line);
+                run("validate_batch", [&](StageResult& result)
+                {
+                    auto started = std::chrono::steady_clock::now();
+                    std::vector<uint8_t> valid = validator.validate_batch(audit);
+                    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+                    size_t passed = std::count(valid.begin(), valid.end(), 1);
+                    require(passed == audit.size(), "validate_batch", "a rejected centre line");
+                    result.details["paths"] = audit.size();
+                    result.details["valid"] = passed;
+                    result.details["paths_per_second"] = seconds > 0 ? std::round(audit.size() / seconds) : 0.0;
+                });
+                // Edge weights for complete adjacency rows over the course's nodes, read as nautical miles
+                // about 5E 50N: planar distances as the graph stores them, against the great-circle kernel at
+                // the detected SIMD level and at scalar. The gap is what geographic input costs per weight.
+                std::vector<Point> planar_nodes;
+                planar_nodes.push_back(course.start);
+                for (const auto& segment : course.segments)
+                {
+                    planar_nodes.push_back(segment.left);
+                    planar_nodes.push_back(segment.right);
+                }
+                planar_nodes.push_back(course.end);
+                LocalProjection projection(5.0, 50.0);
+                std::vector<Point> geographic_nodes;
+                for (auto& point : planar_nodes)
+                {
+                    point = Point(point.label_id, point.x * 1852.0, point.y * 1852.0);
+                    geographic_nodes.push_back(projection.unproject(point));
+                }
+                GeodesicNodes sphere_nodes;
+                sphere_nodes.assign(geographic_nodes);
+                std::vector<int> row_targets(planar_nodes.size());
+                for (size_t j = 0; j < row_targets.size(); ++j)
+                {
+                    row_targets[j] = static_cast<int>(j);
+                }
+                std::vector<double> row_weights(planar_nodes.size());
+                double checksum = 0.0;
+                run("weights_planar", [&](StageResult& result)
+                {
+                    for (size_t i = 0; i < planar_nodes.size(); ++i)
+                    {
+                        for (size_t j = 0; j < planar_nodes.size(); ++j)
+                        {
+                            row_weights[j] = planar_nodes[i].distance_to(planar_nodes[row_targets[j]]);
+                        }
+                        checksum += row_weights.back();
+                    }
+                    result.details["weights"] = planar_nodes.size() * planar_nodes.size();
+                });
+                auto run_geodesic = [&](const std::string& stage, SimdLevel level)
+                {
+                    run(stage, [&, level](StageResult& result)
+                    {
+                        for (size_t i = 0; i < planar_nodes.size(); ++i)
+                        {
+                            GeodesicKernel::row_distances(sphere_nodes, static_cast<int>(i), row_targets.data(), row_targets.size(), row_weights.data(), level);
+                            checksum += row_weights.back();
+                        }
+                        result.details["weights"] = planar_nodes.size() * planar_nodes.size();
+                        result.details["simd"] = IntersectionKernel::simd_level_name(level);
+                    });
+                };
+                run_geodesic("weights_geodesic", IntersectionKernel::detect_simd_level());
+                run_geodesic("weights_geo_scalar", SimdLevel::Scalar);
+                if (checksum < 0.0)
+                {
+                    throw std::runtime_error("Negative edge weight");
+                }
+                for (const auto& stage : stages)
+                {
+                    json entry = stage_to_json(shape_name, size, stage.first, stage.second);
+                    report["results"].push_back(entry);
+                    if (stage.second.ran)
+                    {
+                        std::string notes = stage.second.details.dump();
+                        std::printf("%-8s %8zu %-12s %12.3f %12.3f  %s\n", shape_name.c_str(), size, stage.first.c_str(),
+                                    stage.second.median_ms(), stage.second.min_ms(), notes.c_str());
+                    }
+                    else
+                    {
+                        std::printf("%-8s %8zu %-12s %12s %12s  skipped: %s\n", shape_name.c_str(), size, stage.first.c_str(),
+                                    "-", "-", stage.second.skip_reason.c_str());
+                    }
+                    std::fflush(stdout);
+                }
+            }
+        }
+        std::ofstream file(options.output_file);
+        if (!file.is_open())
+        {
+            std::cerr << "Error: Could not create output file: " << options.output_file << "\n";
+            return 1;
+        }
+        file << report.dump(2) << "\n";
+        std::cout << "\nResults written to: " << options.output_file << "\n";
+        return 0;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,211 @@
+#include "course_generator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+namespace marine_nav
+{
+    namespace
+    {
+        const double kPi = 3.14159265358979323846;
+
+        // A gateway across the rhumb line: it meets the line at distance t from the start, leans by tilt
+        // radians off the line's port normal and extends width * port_share to port of the line.
+        struct Gate
+        {
+            double t;
+            double tilt;
+            double width;
+            double port_share;
+        };
+    }
+
+    uint64_t CourseGenerator::Random::next()
+    {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+
+    double CourseGenerator::Random::uniform(double low, double high)
+    {
+        return low + (high - low) * (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    std::string CourseGenerator::gateway_label(size_t index, bool left)
+    {
+        char buffer[32];
+        std::snprintf(buffer, sizeof(buffer), "G%07zu%c", index, left ? 'A' : 'B');
+        return buffer;
+    }
+
+    GeneratedCourse CourseGenerator::generate(CourseShape shape, size_t segment_count, uint64_t seed)
+    {
+        Random random(seed);
+        std::vector<Gate> gates;
+        gates.reserve(segment_count);
+        double heading = 0.0;
+        double step = 1.0;
+        double t = 0.0;
+        switch (shape)
+        {
+            case CourseShape::ZigZag:
+            {
+                // Four gateways per leg; along a leg the gateways step further to one side of the line,
+                // leaning 45 degrees towards it, and the next leg mirrors them.
+                const size_t per_leg = 4;
+                step = 3.0;
+                for (size_t k = 0; k < segment_count; ++k)
+                {
+                    double sign = (k / per_leg) % 2 == 0 ? 1.0 : -1.0;
+                    double reach = 0.05 + 0.1 * static_cast<double>(k % per_leg);
+                    t += step;
+                    gates.push_back(Gate{t, sign * kPi / 4.0, 2.0, 0.5 + sign * reach});
+                }
+                break;
+            }
+            case CourseShape::Spiral:
+            {
+                // Cross-track offsets from an Archimedean spiral r = a + b * theta with 4 units between
+                // turns, so each gateway widens with the radius to keep the line inside it.
+                const double a = 6.0;
+                const double b = 4.0 / (2.0 * kPi);
+                step = 3.0;
+                double theta = 0.0;
+                for (size_t k = 0; k < segment_count; ++k)
+                {
+                    double r = a + b * theta;
+                    double offset = r * std::sin(theta);
+                    double width = 2.0 * std::fabs(offset) + 2.5;
+                    t += step;
+                    gates.push_back(Gate{t, 0.6 * std::cos(theta), width, 0.5 + offset / width});
+                    theta += step / std::sqrt(b * b + r * r);
+                }
+                break;
+            }
+            case CourseShape::Harbour:
+            {
+                // Dense, narrow gateways whose lean wanders quickly and whose centres sit off the line.
+                step = 0.6;
+                double tilt = 0.0;
+                for (size_t k = 0; k < segment_count; ++k)
+                {
+                    tilt = std::max(-1.0, std::min(1.0, tilt + random.uniform(-0.7, 0.7)));
+                    t += step;
+                    gates.push_back(Gate{t, tilt, random.uniform(0.3, 0.8), random.uniform(0.15, 0.85)});
+                }
+                break;
+            }
+            case CourseShape::OpenSea:
+            {
+                // Sparse, wide gateways 20 to 60 units apart on a random heading, with gentle changes of lean.
+                step = 40.0;
+                heading = random.uniform(-kPi, kPi);
+                double tilt = 0.0;
+                for (size_t k = 0; k < segment_count; ++k)
+                {
+                    tilt = std::max(-0.8, std::min(0.8, tilt + random.uniform(-0.25, 0.25)));
+                    t += random.uniform(20.0, 60.0);
+                    gates.push_back(Gate{t, tilt, random.uniform(5.0, 15.0), random.uniform(0.2, 0.8)});
+                }
+                break;
+            }
+        }
+        // Travel runs along (dx, dy) from the origin; port is (-dy, dx).
+        double dx = std::cos(heading);
+        double dy = std::sin(heading);
+        if (heading == 0.0)
+        {
+            dx = 1.0;
+            dy = 0.0;
+        }
+        GeneratedCourse course;
+        course.segments.reserve(gates.size());
+        course.centre_line.reserve(gates.size() + 2);
+        course.start = Point("FROM", 0.0, 0.0);
+        course.end = Point("TO", (t + step) * dx, (t + step) * dy);
+        course.centre_line.push_back(course.start);
+        for (size_t k = 0; k < gates.size(); ++k)
+        {
+            const Gate& gate = gates[k];
+            double cross_x = gate.t * dx;
+            double cross_y = gate.t * dy;
+            // Unit vector from the right end to the left end: the port normal leaned by tilt.
+            double ux = -dy * std::cos(gate.tilt) + dx * std::sin(gate.tilt);
+            double uy = dx * std::cos(gate.tilt) + dy * std::sin(gate.tilt);
+            double port = gate.width * gate.port_share;
+            double starboard = gate.width - port;
+            Point left(gateway_label(k, true), cross_x + port * ux, cross_y + port * uy);
+            Point right(gateway_label(k, false), cross_x - starboard * ux, cross_y - starboard * uy);
+            course.segments.emplace_back(left, right, static_cast<int>(k));
+            course.centre_line.emplace_back(course.segments.back().crossing_label_id(), cross_x, cross_y);
+        }
+        course.centre_line.push_back(course.end);
+        return course;
+    }
+
+    std::string CourseGenerator::to_json(const GeneratedCourse& course)
+    {
+        std::string json;
+        json.reserve(64 * (2 * course.segments.size() + 2) + 16);
+        char buffer[128];
+        auto append_point = [&](const Point& point, bool last)
+        {
+            std::snprintf(buffer, sizeof(buffer), "    {\"label\": \"%s\", \"x\": %.6f, \"y\": %.6f}%s\n",
+                          point.label().c_str(), point.x, point.y, last ? "" : ",");
+            json += buffer;
+        };
+        json += "{\n  \"points\": [\n";
+        append_point(course.start, false);
+        for (const auto& segment : course.segments)
+        {
+            append_point(segment.left, false);
+            append_point(segment.right, false);
+        }
+        append_point(course.end, true);
+        json += "  ]\n}\n";
+        return json;
+    }
+
+    bool CourseGenerator::parse_shape(const std::string& name, CourseShape& shape)
+    {
+        if (name == "zigzag")
+        {
+            shape = CourseShape::ZigZag;
+        }
+        else if (name == "spiral")
+        {
+            shape = CourseShape::Spiral;
+        }
+        else if (name == "harbour")
+        {
+            shape = CourseShape::Harbour;
+        }
+        else if (name == "opensea")
+        {
+            shape = CourseShape::OpenSea;
+        }
+        else
+        {
+            return false;
+        }
+        return true;
+    }
+
+    const char* CourseGenerator::shape_name(CourseShape shape)
+    {
+        switch (shape)
+        {
+            case CourseShape::ZigZag:
+                return "zigzag";
+            case CourseShape::Spiral:
+                return "spiral";
+            case CourseShape::Harbour:
+                return "harbour";
+            case CourseShape::OpenSea:
+                return "opensea";
+        }
+        return "unknown";
+    }
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "geometry.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+namespace marine_nav
+{
+    enum class CourseShape
+    {
+        ZigZag,     // legs of gateways stepping out to alternate sides of the rhumb line
+        Spiral,     // cross-track offsets of an Archimedean spiral, gateways widening with the radius
+        Harbour,    // dense, narrow gateways with quickly wandering lean and offset
+        OpenSea     // sparse, wide gateways on a random heading with gentle changes of lean
+    };
+
+    // A generated course: gateways in order plus the start/end points and the track along the rhumb
+    // line (start, the point where it crosses each gateway, end).
+    struct GeneratedCourse
+    {
+        std::vector<Segment> segments;
+        Point start;
+        Point end;
+        std::vector<Point> centre_line;
+        GeneratedCourse() : start("FROM", 0.0, 0.0), end("TO", 0.0, 0.0) {}
+    };
+
+    // Deterministic synthetic gateway courses for benchmarking. The same shape, size and seed always
+    // produce the same course on every platform (the generator carries its own SplitMix64 stream).
+    // Gateway k is labelled G<k>A (left) / G<k>B (right) with zero-padded k, so the input format's
+    // label sort recovers the generation order. Every gateway straddles the straight rhumb line from
+    // start to end with its left end to port, as the all-segments orientation rule requires of every
+    // leg. A gateway end is collinear with its own gateway, so no leg can start or end at one; the
+    // direct start-to-end leg is therefore the course's route, and the shapes differ in how the
+    // gateways lie around it.
+    class CourseGenerator
+    {
+        private:
+            struct Random
+            {
+                uint64_t state;
+                explicit Random(uint64_t seed) : state(seed) {}
+                uint64_t next();
+                // Uniform in [low, high).
+                double uniform(double low, double high);
+            };
+            static std::string gateway_label(size_t index, bool left);
+        public:
+            static GeneratedCourse generate(CourseShape shape, size_t segment_count, uint64_t seed = 1);
+            // Input JSON in the format JsonParser reads (points labelled FROM, TO and G<k>A/B).
+            static std::string to_json(const GeneratedCourse& course);
+            static bool parse_shape(const std::string& name, CourseShape& shape);
+            static const char* shape_name(CourseShape shape);
+    };
+}
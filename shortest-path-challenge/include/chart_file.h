@@ -0,0 +1,113 @@
+#pragma once
+#include "geometry.h"
+#include "mapped_file.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+namespace marine_nav
+{
+    class VisibilityGraph;
+
+    // Fixed-size header at offset 0 of a chart file. All values are little-endian and every
+    // section that follows starts on an 8-byte boundary, so the arrays can be used straight
+    // from the mapping.
+    struct ChartHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t flags;
+        uint64_t segment_count;
+        uint64_t label_count;
+        uint64_t label_bytes;
+        uint64_t node_count;    // 0 when the chart carries no graph
+        uint64_t entry_count;   // CSR entries (two per undirected edge)
+        double start_x, start_y, end_x, end_y;
+        uint32_t start_label, end_label;
+    };
+
+    // Versioned binary chart: the segment SoA arrays (left_x, left_y, right_x, right_y, order),
+    // left/right label ids into an interned label table and, optionally, the visibility graph's
+    // CSR rows with their edge weights. Layout after the header:
+    //   double left_x[S], left_y[S], right_x[S], right_y[S]; int32 order[S];
+    //   uint32 left_label[S], right_label[S];
+    //   uint64 label_offsets[L + 1]; char label_chars[label_bytes];
+    //   uint64 row_offsets[N + 1]; double weights[E]; int32 targets[E]   (graph only)
+    class ChartFile
+    {
+        private:
+            MappedFile file_;
+            const ChartHeader* header_;
+            const double* left_x_;
+            const double* left_y_;
+            const double* right_x_;
+            const double* right_y_;
+            const int32_t* order_;
+            const uint32_t* left_label_;
+            const uint32_t* right_label_;
+            const uint64_t* label_offsets_;
+            const char* label_chars_;
+            const uint64_t* row_offsets_;
+            const double* weights_;
+            const int32_t* targets_;
+        public:
+            static const uint32_t kVersion = 1;
+            static const uint32_t kHasGraph = 1;
+            // Maps and validates filename; throws std::runtime_error on a bad magic, version or size.
+            explicit ChartFile(const std::string& filename);
+            // True when filename starts with the chart magic, so callers can tell charts from JSON.
+            static bool is_chart_file(const std::string& filename);
+            // graph, when given, must be an eager build over exactly segments, start and end.
+            static void write(const std::string& filename, const std::vector<Segment>& segments, const Point& start, const Point& end,
+                              const VisibilityGraph* graph = nullptr);
+            size_t get_file_size() const
+            {
+                return file_.size();
+            }
+            uint32_t get_version() const
+            {
+                return header_->version;
+            }
+            size_t get_segment_count() const
+            {
+                return static_cast<size_t>(header_->segment_count);
+            }
+            size_t get_label_count() const
+            {
+                return static_cast<size_t>(header_->label_count);
+            }
+            std::string get_label(uint32_t id) const;
+            bool has_graph() const
+            {
+                return (header_->flags & kHasGraph) != 0;
+            }
+            size_t get_node_count() const
+            {
+                return static_cast<size_t>(header_->node_count);
+            }
+            size_t get_entry_count() const
+            {
+                return static_cast<size_t>(header_->entry_count);
+            }
+            const double* get_left_x() const { return left_x_; }
+            const double* get_left_y() const { return left_y_; }
+            const double* get_right_x() const { return right_x_; }
+            const double* get_right_y() const { return right_y_; }
+            const int32_t* get_order() const { return order_; }
+            // CSR arrays in the layout VisibilityGraph::attach_graph expects; null without a graph.
+            const size_t* get_row_offsets() const
+            {
+                return reinterpret_cast<const size_t*>(row_offsets_);
+            }
+            const int* get_row_targets() const
+            {
+                return reinterpret_cast<const int*>(targets_);
+            }
+            const double* get_row_weights() const
+            {
+                return weights_;
+            }
+            Point get_start() const;
+            Point get_end() const;
+            std::vector<Segment> load_segments() const;
+    };
+}
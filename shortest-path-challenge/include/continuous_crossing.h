@@ -0,0 +1,31 @@
+#pragma once
+#include "shortest_path.h"
+#include <vector>
+namespace marine_nav
+{
+    // Short route that crosses every gateway in order anywhere along its segment, not only at the
+    // endpoints. A funnel (string-pulling) pass over the gateways gives the taut route in O(S); then
+    // coordinate-descent sweeps move each crossing to its best point given its neighbours until a sweep
+    // gains less than the tolerance. This is a local improvement, not a proof of optimality: the length
+    // is a non-smooth sum of norms, and coordinate descent can stall short of the minimum.
+    class ContinuousCrossingSolver
+    {
+        private:
+            int max_sweeps_;
+            double tolerance_;
+            int last_sweeps_;
+            bool last_converged_;
+            std::vector<Point> string_pull(const std::vector<const Segment*>& gateways, const Point& start, const Point& end) const;
+            static double path_length(const std::vector<Point>& path);
+        public:
+            ContinuousCrossingSolver();
+            void set_max_sweeps(int max_sweeps) { max_sweeps_ = max_sweeps; }
+            // Relative length gain below which a sweep counts as converged.
+            void set_tolerance(double tolerance) { tolerance_ = tolerance; }
+            int get_last_sweeps() const { return last_sweeps_; }
+            // False when the last solve ran out of sweeps before the gain fell below the tolerance.
+            bool get_last_converged() const { return last_converged_; }
+            // Path is start, one crossing point per gateway in order, end.
+            PathResult solve(const std::vector<Segment>& segments, const Point& start, const Point& end);
+    };
+}
@@ -0,0 +1,70 @@
+#pragma once
+#include "geometry.h"
+#include "mapped_file.h"
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+namespace marine_nav
+{
+    class VisibilityGraph;
+
+    // Fixed-size header at offset 0 of an oracle file, little-endian like ChartHeader.
+    struct OracleHeader
+    {
+        char magic[8];
+        uint32_t version;
+        uint32_t flags;
+        uint64_t node_count;
+        uint64_t segment_count;
+        uint64_t fingerprint;   // DistanceOracle::fingerprint of the segments it was built over
+    };
+
+    // Exact shortest distances between every pair of gateway endpoints of a gateway graph
+    // (VisibilityGraph::build_gateway_graph). Routes only follow forward edges, towards higher node
+    // indices, so only the v >= u half can be finite; it is kept packed row by row: N (N + 1) / 2
+    // doubles for N = 2S nodes, infinity where no route exists. A file holds the header and that
+    // array, and load() maps it in place.
+    //
+    // Memory grows with S², so an oracle suits courses of up to a few thousand gateways.
+    class DistanceOracle
+    {
+        private:
+            std::unique_ptr<MappedFile> file_;
+            std::vector<double> owned_;
+            const double* distances_;
+            size_t node_count_;
+            size_t segment_count_;
+            uint64_t fingerprint_;
+            size_t row_offset(size_t u) const
+            {
+                return u * node_count_ - u * (u - 1) / 2;   // u = 0 gives 0 despite the unsigned wrap
+            }
+        public:
+            static const uint32_t kVersion = 1;
+            DistanceOracle();
+            // Hash of the segments' coordinates and orders; load() refuses an oracle built over others.
+            static uint64_t fingerprint(const std::vector<Segment>& segments);
+            // One Dijkstra per node over graph's rows, spread over thread_count threads (0 = all cores).
+            void build(const VisibilityGraph& graph, const std::vector<Segment>& segments, size_t thread_count);
+            void write(const std::string& filename) const;
+            // Maps filename; throws std::runtime_error on a bad magic, version or size, or when it was
+            // built over different segments.
+            void load(const std::string& filename, const std::vector<Segment>& segments);
+            void clear();
+            bool is_ready() const { return distances_ != nullptr; }
+            size_t get_node_count() const { return node_count_; }
+            size_t get_entry_count() const { return node_count_ * (node_count_ + 1) / 2; }
+            // Shortest distance from node u to node v; infinity when v comes before u.
+            double distance(size_t u, size_t v) const
+            {
+                return u <= v ? distances_[row_offset(u) + (v - u)] : std::numeric_limits<double>::infinity();
+            }
+            // distance(u, v) for v = u, u + 1, ..., N - 1, contiguous.
+            const double* row_from(size_t u) const
+            {
+                return distances_ + row_offset(u);
+            }
+    };
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "segment_kernels.h"
+#include <cstddef>
+#include <vector>
+namespace marine_nav
+{
+    struct Point;
+
+    enum class CoordinateSystem
+    {
+        Planar,     // x and y are already planar units; distances are Euclidean
+        Geographic  // x is longitude and y latitude in degrees; distances are great-circle metres
+    };
+
+    // Equirectangular projection about a reference longitude/latitude: degrees become metres east and
+    // north of the origin, with east scaled by cos(origin latitude). Visibility is judged on straight
+    // legs in this frame, so it suits regional charts rather than ocean crossings.
+    class LocalProjection
+    {
+        private:
+            double origin_lon_;
+            double origin_lat_;
+            double metres_per_degree_x_;
+            double metres_per_degree_y_;
+        public:
+            LocalProjection(double origin_lon, double origin_lat);
+            // Centred on the longitude/latitude box of points; longitudes may wrap across the antimeridian.
+            // Throws std::invalid_argument for a point outside [-180, 180] x [-90, 90].
+            static LocalProjection around(const std::vector<Point>& points);
+            // Same label; planar metres from longitude/latitude and back again.
+            Point project(const Point& geographic) const;
+            Point unproject(const Point& planar) const;
+            double get_origin_lon() const { return origin_lon_; }
+            double get_origin_lat() const { return origin_lat_; }
+    };
+
+    // Unit vectors on the sphere for a set of longitude/latitude points, as three coordinate arrays. The
+    // trigonometry is paid once here, so a distance between two of them needs only a square root and
+    // an arcsine.
+    struct GeodesicNodes
+    {
+        std::vector<double> x;
+        std::vector<double> y;
+        std::vector<double> z;
+        void assign(const std::vector<Point>& geographic);
+        void clear();
+        size_t size() const
+        {
+            return x.size();
+        }
+    };
+
+    class GeodesicKernel
+    {
+        public:
+            // Mean Earth radius (IUGG), metres. Distances are spherical, within about 0.5% of the ellipsoid.
+            static constexpr double kEarthRadius = 6371008.8;
+            // Great-circle distance in metres between two longitude/latitude points in degrees.
+            static double distance(const Point& a, const Point& b);
+            // out[k] = great-circle distance from node from to node targets[k]: the haversine in chord
+            // form, hav(theta) = (chord / 2)^2, so a whole adjacency row streams through the vector
+            // registers. Every level returns bit-identical results.
+            static void row_distances(const GeodesicNodes& nodes, int from, const int* targets, size_t count, double* out, SimdLevel level);
+        private:
+            static void row_distances_scalar(const GeodesicNodes& nodes, int from, const int* targets, size_t count, double* out);
+            static void row_distances_sse2(const GeodesicNodes& nodes, int from, const int* targets, size_t count, double* out);
+            static void row_distances_avx2(const GeodesicNodes& nodes, int from, const int* targets, size_t count, double* out);
+    };
+}
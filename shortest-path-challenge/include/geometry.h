@@ -1,16 +1,28 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include <string>
 #include <memory>
 #include <geos_c.h>
+#include "geos_prepared.h"
+#include "label_table.h"
+#include "segment_kernels.h"
+#include "spatial_index.h"
 namespace marine_nav 
 {
+    // The label lives in LabelTable::global(); a Point is just its id and coordinates.
     struct Point 
     {
-        std::string label;
+        uint32_t label_id;
         double x, y;
         Point(const std::string& label, double x, double y) 
-            : label(label), x(x), y(y) {}
+            : label_id(LabelTable::global().intern(label)), x(x), y(y) {}
+        Point(uint32_t label_id, double x, double y) 
+            : label_id(label_id), x(x), y(y) {}
+        const std::string& label() const 
+        {
+            return LabelTable::global().name(label_id);
+        }
         double distance_to(const Point& other) const;
     };
 
@@ -19,22 +31,61 @@ namespace marine_nav
         Point left;
         Point right;
         int order; 
-            Segment(const Point& left, const Point& right, int order)
+        Segment(const Point& left, const Point& right, int order)
             : left(left), right(right), order(order) {}
+        // Label of the points get_optimal_crossing_point returns, interned on first use (LabelTable::crossing).
+        uint32_t crossing_label_id() const
+        {
+            return LabelTable::global().crossing(order);
+        }
         bool is_point_on_correct_side(const Point& point, bool should_be_left) const;
+        double distance_to(const Point& point) const;
+        double distance_to(const Segment& other) const;
         Point get_optimal_crossing_point(const Point& from, const Point& to) const;
     };
     
+    enum class IntersectionBackend
+    {
+        Native,
+        Geos
+    };
+
     class GeometryEngine 
     {
         private:
-            GEOSContextHandle_t geos_context_;
+            IntersectionBackend backend_;
+            SimdLevel simd_level_;
+            SegmentArrays prepared_arrays_;
+            const std::vector<Segment>* prepared_source_;
+            SegmentIndex segment_index_;
+            bool use_spatial_index_;
+            GeosPreparedSegments geos_prepared_;
+            bool geos_intersects_any(const Point& from, const Point& to, const std::vector<Segment>& segments, int min_order) const;
         public:
             GeometryEngine();
-            ~GeometryEngine();    
+            GeometryEngine(const GeometryEngine&) = delete;
+            GeometryEngine& operator=(const GeometryEngine&) = delete;
+            // GEOS calls run on the calling thread's context (GeosContext), so with either backend one
+            // engine can be shared by every thread once its segments are prepared.
+            void set_intersection_backend(IntersectionBackend backend);
+            IntersectionBackend get_intersection_backend() const { return backend_; }
+            void set_simd_level(SimdLevel level);
+            SimdLevel get_simd_level() const { return simd_level_; }
+            // Caches an SoA copy and an R-tree of segments, plus GEOS-prepared lines on the GEOS backend;
+            // is_visible uses them whenever it is handed the same vector.
+            void prepare_segments(const std::vector<Segment>& segments);
+            void clear_prepared_segments();
+            void set_spatial_index(bool enabled) { use_spatial_index_ = enabled; }
+            bool uses_spatial_index() const { return use_spatial_index_; }
+            const SegmentIndex& get_segment_index() const { return segment_index_; }
             bool line_intersects_obstacles(const Point& from, const Point& to, const std::vector<Segment>& segments) const;
+            // Every leg, in travel direction, keeps each segment's left end strictly to port and its right end
+            // strictly to starboard.
             bool path_maintains_constraints(const std::vector<Point>& path, const std::vector<Segment>& segments) const;
             double calculate_distance(const Point& from, const Point& to) const;  
             bool is_visible(const Point& from, const Point& to, const std::vector<Segment>& segments, int current_segment_order) const;
+            // Orientation against every segment plus is_visible's crossing test, fused into one pass (see
+            // IntersectionKernel::first_violation). Native backend only; GEOS callers keep the staged checks.
+            ConstraintFailure check_constraints(const Point& from, const Point& to, const std::vector<Segment>& segments, int current_segment_order) const;
     };
 } 
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <geos_c.h>
+namespace marine_nav
+{
+    struct Segment;
+
+    // One GEOS context per thread, created by the thread's first GEOS call and finished when the
+    // thread exits. Engines no longer own a context, so one engine can serve every worker.
+    class GeosContext
+    {
+        public:
+            static GEOSContextHandle_t local();
+    };
+
+    // GEOSPrepare_r copies of a gateway set, built once per input: one prepared line per segment and
+    // one prepared multi-line over all of them. GEOS builds a prepared geometry's segment index on its
+    // first query, so build() runs that query up front; afterwards the set is read-only and can be
+    // queried from any thread with that thread's context.
+    class GeosPreparedSegments
+    {
+        private:
+            GEOSGeometry* collection_;                       // owns the per-segment lines below
+            const GEOSPreparedGeometry* prepared_collection_;
+            std::vector<const GEOSPreparedGeometry*> prepared_lines_;
+        public:
+            GeosPreparedSegments();
+            ~GeosPreparedSegments();
+            GeosPreparedSegments(const GeosPreparedSegments&) = delete;
+            GeosPreparedSegments& operator=(const GeosPreparedSegments&) = delete;
+            void build(const std::vector<Segment>& segments);
+            void clear();
+            size_t size() const
+            {
+                return prepared_lines_.size();
+            }
+            // Two-point line for a query; the caller destroys it with GEOSGeom_destroy_r.
+            static GEOSGeometry* create_line(GEOSContextHandle_t context, double from_x, double from_y, double to_x, double to_y);
+            // line against every segment at once.
+            bool intersects_any(GEOSContextHandle_t context, const GEOSGeometry* line) const;
+            // line against segment i of the built set.
+            bool intersects(GEOSContextHandle_t context, size_t i, const GEOSGeometry* line) const;
+    };
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include "metrics.h"
+#include "solver_workspace.h"
+#include <cstddef>
+#include <limits>
+namespace marine_nav
+{
+    // The single-source loop behind every search over a VisibilityGraph. Node state lives in workspace,
+    // which is begun for node_count nodes and seeded with source. Each settled node u is handed to
+    // expand(u, relax), which calls relax(v, weight) for every edge the caller lets a route take out of
+    // u (usually forward_part of u's row, plus any edges of nodes outside the graph). estimate(v) must
+    // be a consistent lower bound on the distance from v to target, or 0 for plain Dijkstra. The search
+    // stops once target is settled; a target of -1 runs it to exhaustion. Returns the nodes settled.
+    template <typename Expand, typename Estimate>
+    size_t search_from(SolverWorkspace& workspace, size_t node_count, int source, int target, Expand&& expand, Estimate&& estimate)
+    {
+        const double infinity = std::numeric_limits<double>::infinity();
+        workspace.begin(node_count);
+        DaryHeap<4>& heap = workspace.heap;
+        workspace.set_distance(source, 0.0, -1);
+        heap.push(estimate(source), source);
+        MARINE_NAV_COUNT(HeapPushes);
+        size_t settled = 0;
+        while (!heap.empty())
+        {
+            DaryHeap<4>::Entry current = heap.top();
+            heap.pop();
+            MARINE_NAV_COUNT(HeapPops);
+            int u = current.node;
+            double distance_u = workspace.distance(u);
+            if (current.key > distance_u + estimate(u) || workspace.settled(u) != infinity)
+            {
+                MARINE_NAV_COUNT(StalePops);
+                continue;
+            }
+            workspace.set_settled(u, distance_u);
+            ++settled;
+            if (u == target)
+            {
+                break;
+            }
+            expand(u, [&](int v, double weight)
+            {
+                double candidate = distance_u + weight;
+                if (workspace.settled(v) == infinity && candidate < workspace.distance(v))
+                {
+                    workspace.set_distance(v, candidate, u);
+                    heap.push(candidate + estimate(v), v);
+                    MARINE_NAV_COUNT(HeapPushes);
+                }
+            });
+        }
+        return settled;
+    }
+
+    // Plain Dijkstra: search_from with a zero estimate.
+    template <typename Expand>
+    size_t search_from(SolverWorkspace& workspace, size_t node_count, int source, int target, Expand&& expand)
+    {
+        return search_from(workspace, node_count, source, target, expand, [](int) { return 0.0; });
+    }
+}
@@ -0,0 +1,119 @@
+#pragma once
+#include "spatial_index.h"
+#include "visibility_graph.h"
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+namespace marine_nav
+{
+    // Visibility graph that follows gateway changes without a rebuild. Every node pair is either an
+    // edge, rejected by the ordering constraint, or blocked. A pair blocked by the segment of one of its
+    // own endpoints needs no record: removing or moving that segment revisits all of its nodes' pairs
+    // anyway. A pair blocked only by a third segment records that segment (its witness) in a hash map,
+    // and each segment keeps the list of pairs it witnesses.
+    //  - insert: the edges an EdgeIndex query returns are re-tested, against the new segment alone,
+    //    plus the pairs of the two new nodes;
+    //  - remove: only the pairs the segment witnessed are re-evaluated;
+    //  - update: both of the above, plus every pair of the moved endpoints.
+    // Node 0 is start, node 1 is end and segment slot k owns nodes 2 + 2k (left) and 3 + 2k (right).
+    // The edge set always equals a fresh build_graph over the live segments in slot order. Memory is
+    // the edges plus the third-party witnesses; under the all-segments orientation rule every gateway
+    // endpoint is blocked by its own segment, so the witness map stays small.
+    class IncrementalVisibilityGraph
+    {
+        public:
+            struct Neighbor
+            {
+                int target;
+                double weight;
+            };
+        private:
+            static constexpr int32_t kEdge = -1;
+            static constexpr int32_t kOrdering = -2;
+            static constexpr int32_t kDead = -3;
+            static constexpr int32_t kOwnSegment = -4;   // blocked by the segment of one of its endpoints
+            std::vector<Segment> segments_;
+            std::vector<char> segment_alive_;
+            std::vector<GraphNode> nodes_;
+            std::vector<std::vector<Neighbor>> rows_;
+            // kEdge or a third-party witness slot per pair key; every other pair is absent.
+            std::unordered_map<uint64_t, int32_t> witness_;
+            std::vector<std::vector<uint64_t>> witnessed_pairs_;
+            EdgeIndex edge_index_;
+            std::unordered_set<uint64_t> indexed_edges_;   // live edges the index holds
+            std::vector<uint64_t> unindexed_edges_;        // edges added since the index was packed
+            std::vector<char> changed_;
+            std::vector<int> changed_nodes_;
+            size_t edge_count_;
+            size_t pairs_evaluated_;
+            size_t segment_checks_;
+            // u < v.
+            static uint64_t pair_key(int u, int v)
+            {
+                return (static_cast<uint64_t>(u) << 32) | static_cast<uint32_t>(v);
+            }
+            int32_t witness_of(uint64_t key) const
+            {
+                auto it = witness_.find(key);
+                return it == witness_.end() ? kDead : it->second;
+            }
+            // Node of the pair that build_graph would use as "from" (start first, end last).
+            bool precedes(int u, int v) const;
+            int32_t evaluate(int u, int v);
+            void apply(int u, int v, int32_t witness);
+            void add_edge(int u, int v);
+            void remove_edge(int u, int v);
+            void mark_changed(int node);
+            void add_nodes(const Segment& segment);
+            void reevaluate_node_pairs(int node);
+            void reevaluate_witnessed(int slot);
+            void rebuild_edge_index();
+            void block_edges_with(int slot);
+        public:
+            IncrementalVisibilityGraph();
+            void build(const std::vector<Segment>& segments, const Point& start, const Point& end);
+            // Returns the new segment's slot.
+            int insert_segment(const Segment& segment);
+            void remove_segment(int slot);
+            void update_segment(int slot, const Segment& segment);
+            const std::vector<Neighbor>& get_neighbors(int node) const
+            {
+                return rows_[node];
+            }
+            const GraphNode& get_node(int node) const
+            {
+                return nodes_[node];
+            }
+            size_t get_node_count() const
+            {
+                return nodes_.size();
+            }
+            bool is_node_alive(int node) const;
+            bool is_segment_alive(int slot) const
+            {
+                return slot >= 0 && static_cast<size_t>(slot) < segments_.size() && segment_alive_[slot];
+            }
+            size_t get_segment_slot_count() const
+            {
+                return segments_.size();
+            }
+            // Live segments in slot order, as build_graph would take them.
+            std::vector<Segment> get_live_segments() const;
+            size_t get_edge_count() const
+            {
+                return edge_count_;
+            }
+            // Full pair evaluations and single-segment checks since build (build included).
+            size_t get_pairs_evaluated() const
+            {
+                return pairs_evaluated_;
+            }
+            size_t get_segment_checks() const
+            {
+                return segment_checks_;
+            }
+            // Nodes whose rows changed since the last call; LpaStarSolver re-examines exactly these.
+            std::vector<int> take_changed_nodes();
+    };
+}
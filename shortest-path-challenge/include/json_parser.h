@@ -1,10 +1,13 @@
 #pragma once
 #include "geometry.h"
+#include <cstddef>
 #include <string>
 #include <vector>
 #include <nlohmann/json.hpp>
 namespace marine_nav 
 {
+    class VisibilityGraph;
+
     struct InputData 
     {
         std::vector<Point> points;
@@ -13,16 +16,86 @@ namespace marine_nav
         Point end;
         InputData(const Point& s, const Point& e) : start(s), end(e) {}
     };
+
+    // One line of a --batch queries file. The query's own labels stay here rather than in the
+    // process-wide LabelTable, which never frees; start and end carry the shared FROM and TO ids.
+    struct RouteQuery 
+    {
+        std::string id;
+        Point start;
+        Point end;
+        std::string start_label;
+        std::string end_label;
+        RouteQuery(const std::string& id, const Point& s, const Point& e, const std::string& start_label, const std::string& end_label) 
+            : id(id), start(s), end(e), start_label(start_label), end_label(end_label) {}
+    };
+    
+    // A --matrix file: {"starts": [{"label": .., "x": .., "y": ..}, ...], "ends": [...]}. Labels default
+    // to FROM and TO.
+    struct FleetQuery 
+    {
+        std::vector<Point> starts;
+        std::vector<Point> ends;
+    };
+    
+    // One line of an --updates file: {"op": "insert" | "remove" | "update", "segment": slot, "order": n,
+    // "left": {"label": .., "x": .., "y": ..}, "right": {...}}. Slots number the input's gateways from 0
+    // and inserted gateways continue from there; omitted labels and order keep the current ones.
+    struct SegmentUpdate 
+    {
+        enum class Kind { Insert, Remove, Update };
+        Kind kind;
+        int slot;
+        bool has_geometry;
+        std::string left_label, right_label;
+        double left_x, left_y, right_x, right_y;
+        bool has_order;
+        int order;
+        SegmentUpdate() : kind(Kind::Remove), slot(-1), has_geometry(false), left_x(0.0), left_y(0.0), right_x(0.0), right_y(0.0), 
+                          has_order(false), order(0) {}
+    };
+
+    // Bytes consumed and wall time of one file parse, from mapping the file to the finished segments.
+    struct ParseStats 
+    {
+        size_t bytes = 0;
+        double seconds = 0.0;
+        double megabytes_per_second() const 
+        {
+            return seconds > 0.0 ? (bytes / (1024.0 * 1024.0)) / seconds : 0.0;
+        }
+    };
     
+    // Input files are memory-mapped and parsed with a SAX handler that appends points as they are
+    // read, so no DOM is built and the file is never copied into an intermediate string.
     class JsonParser 
     {
         public:
-            static InputData parse_input_file(const std::string& filename);    
+            static InputData parse_input_file(const std::string& filename, ParseStats* stats = nullptr);    
             static InputData parse_input_string(const std::string& json_str);
+            // Gateway segments only; the start/end points are optional here and excluded when present.
+            static std::vector<Segment> parse_segments_file(const std::string& filename, ParseStats* stats = nullptr);
+            // {"id": ..., "start": {"x": .., "y": ..}, "end": {...}}; id defaults to fallback_id.
+            static RouteQuery parse_route_query(const std::string& line, const std::string& fallback_id);
+            static SegmentUpdate parse_segment_update(const std::string& line);
+            static FleetQuery parse_fleet_file(const std::string& filename);
+            // The path's first and last points are written with the query's start and end labels.
+            static std::string export_route_to_json_line(const RouteQuery& query, const std::vector<Point>& path, double total_distance, bool found);
+            // Binary chart (see ChartFile) of the input's segments and endpoints, plus graph's CSR rows when
+            // given; graph must be an eager build over input_data.
+            static void export_chart_file(const InputData& input_data, const std::string& filename, const VisibilityGraph* graph = nullptr);
             static std::string export_path_to_json(const std::vector<Point>& path, double total_distance);
             static void export_path_to_file(const std::vector<Point>& path, double total_distance, const std::string& filename);
+            // The first route in export_path_to_json's layout, plus "alternatives": every route (the first
+            // included) as {"total_distance", "path"}, shortest first.
+            static void export_routes_to_file(const std::vector<std::vector<Point>>& paths, const std::vector<double>& distances, const std::string& filename);
+            // {"costs": [[...]], "paths": [[{"total_distance", "path"}, ...]]}: one row per start, one column
+            // per end, null for unreachable pairs. costs is row-major; paths may be empty to omit them.
+            static void export_route_matrix_to_file(const std::vector<double>& costs, const std::vector<std::vector<Point>>& paths, size_t columns, const std::string& filename);
         private:
-            static std::vector<Segment> create_segments_from_points(const std::vector<Point>& points);
+            static void parse_points(const char* begin, const char* end, std::vector<Point>& points, std::string& start_label, std::string& end_label);
+            static InputData parse_input_buffer(const char* begin, const char* end);
+            static std::vector<Segment> create_segments_from_points(std::vector<Point> points);
             static Point find_point_by_label(const std::vector<Point>& points, const std::string& label);
     };
 } 
@@ -0,0 +1,55 @@
+#pragma once
+#include "shortest_path.h"
+#include "solver_workspace.h"
+#include <vector>
+namespace marine_nav
+{
+    // Yen's loopless K shortest paths over an eager VisibilityGraph. The build checks each pair only from
+    // its lower node index to its higher one, while the rows store the edge both ways, so routes here
+    // take edges forward only (towards higher indices, i.e. in gateway order). Every leg is then one the
+    // build checked in its direction of travel, and each returned route satisfies the constraints.
+    //
+    // One Dijkstra backwards from the target over the forward edges gives the exact remaining distance
+    // from every node. That single tree is shared by all spur searches as an A* heuristic: blocking nodes
+    // and edges only lengthens routes, so it stays admissible and consistent, and a spur search whose
+    // best continuation is unblocked settles only the nodes on it.
+    class KShortestPaths
+    {
+        private:
+            struct Route
+            {
+                std::vector<int> nodes;
+                std::vector<double> prefix;   // prefix[i]: cost from nodes[0] to nodes[i]
+                double cost;
+            };
+            const VisibilityGraph& graph_;
+            SolverWorkspace workspace_;
+            std::vector<double> to_target_;
+            std::vector<uint32_t> blocked_node_;
+            uint32_t blocked_generation_;
+            std::vector<int> blocked_edges_;   // targets removed from the current spur node's row
+            size_t spur_searches_;
+            size_t nodes_settled_;
+            void compute_tree(int target);
+            // A* from spur to target avoiding blocked nodes and the spur's blocked edges; appends the
+            // route after spur to tail and returns its cost, or infinity if target is unreachable.
+            double spur_search(int spur, int target, std::vector<int>& tail);
+            double edge_weight(int from, int to) const;
+            PathResult to_result(const Route& route) const;
+        public:
+            // graph must be an eager (or attached) build and must outlive the finder.
+            explicit KShortestPaths(const VisibilityGraph& graph);
+            // Up to k routes from source to target, shortest first; fewer when fewer loopless routes exist,
+            // and none when target does not come after source in node order.
+            std::vector<PathResult> find(int source, int target, size_t k);
+            size_t get_spur_searches() const
+            {
+                return spur_searches_;
+            }
+            // Nodes settled over the shared tree and every spur search of the last find().
+            size_t get_nodes_settled() const
+            {
+                return nodes_settled_;
+            }
+    };
+}
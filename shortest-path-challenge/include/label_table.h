@@ -0,0 +1,36 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+namespace marine_nav
+{
+    // Process-wide label interning. Geometry stores only the 32-bit id; each label's text is
+    // kept once here and found by a hash index. Ids are never reused, and references returned
+    // by name stay valid for the life of the process.
+    class LabelTable
+    {
+        private:
+            mutable std::mutex mutex_;
+            std::deque<std::string> names_;
+            std::unordered_map<std::string, uint32_t> ids_;
+            std::unordered_map<int, uint32_t> crossing_ids_;   // segment order -> id of "crossing_<order>"
+            LabelTable() = default;
+            uint32_t intern_locked(const std::string& label);
+        public:
+            static const uint32_t kNotFound = UINT32_MAX;
+            static LabelTable& global();
+            LabelTable(const LabelTable&) = delete;
+            LabelTable& operator=(const LabelTable&) = delete;
+            uint32_t intern(const std::string& label);
+            // kNotFound when label was never interned (so no point can carry it).
+            uint32_t find(const std::string& label) const;
+            // Id of "crossing_<order>", formatted and interned on the first call for that order only.
+            uint32_t crossing(int order);
+            // kNotFound until crossing(order) has run, so no point can carry that crossing label yet.
+            uint32_t find_crossing(int order) const;
+            const std::string& name(uint32_t id) const;
+            size_t size() const;
+    };
+}
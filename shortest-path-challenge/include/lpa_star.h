@@ -0,0 +1,66 @@
+#pragma once
+#include "incremental_graph.h"
+#include "shortest_path.h"
+#include <vector>
+namespace marine_nav
+{
+    // Lifelong Planning A* over an IncrementalVisibilityGraph with fixed start (node 0) and end
+    // (node 1). The first solve is an ordinary A* with the straight-line heuristic; later solves
+    // only revisit the nodes whose rows the graph reports as changed, and the nodes whose
+    // distance those changes actually move.
+    class LpaStarSolver
+    {
+        private:
+            struct Key
+            {
+                double primary;
+                double secondary;
+                bool operator<(const Key& other) const
+                {
+                    return primary < other.primary || (primary == other.primary && secondary < other.secondary);
+                }
+                bool operator==(const Key& other) const
+                {
+                    return primary == other.primary && secondary == other.secondary;
+                }
+            };
+            struct QueueEntry
+            {
+                Key key;
+                int node;
+                bool operator>(const QueueEntry& other) const
+                {
+                    return other.key < key;
+                }
+            };
+            IncrementalVisibilityGraph& graph_;
+            std::vector<double> g_;
+            std::vector<double> rhs_;
+            std::vector<double> heuristic_;
+            // Key of each node's live queue entry; entries whose key no longer matches are skipped.
+            std::vector<Key> queued_key_;
+            std::vector<char> queued_;
+            std::vector<QueueEntry> queue_;
+            bool initialized_;
+            Key calculate_key(int node) const;
+            void grow();
+            // Recomputes rhs from the node's row, then requeues it.
+            void update_vertex(int node);
+            // Queues the node under its current key if it is inconsistent, otherwise dequeues it.
+            void requeue(int node);
+            void push(int node);
+            bool top(QueueEntry& entry);
+            size_t compute_shortest_path();
+            std::vector<Point> extract_path() const;
+        public:
+            explicit LpaStarSolver(IncrementalVisibilityGraph& graph);
+            // Brings the distances up to date with every graph change since the previous call;
+            // nodes_settled counts the expansions this call needed.
+            PathResult solve();
+            // Forgets all search state so the next solve starts from scratch.
+            void reset()
+            {
+                initialized_ = false;
+            }
+    };
+}
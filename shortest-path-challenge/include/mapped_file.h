@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <string>
+namespace marine_nav
+{
+    // Read-only memory mapping of a whole file. The parser walks the mapped bytes in place, so a
+    // chart is never copied into a std::string before it is parsed.
+    class MappedFile
+    {
+        private:
+            const char* data_;
+            size_t size_;
+#ifdef _WIN32
+            void* file_handle_;
+            void* mapping_handle_;
+#endif
+            void close();
+        public:
+            explicit MappedFile(const std::string& filename);
+            ~MappedFile();
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+            const char* data() const
+            {
+                return data_;
+            }
+            size_t size() const
+            {
+                return size_;
+            }
+            const char* begin() const
+            {
+                return data_;
+            }
+            const char* end() const
+            {
+                return data_ + size_;
+            }
+    };
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Hot-path counters and phase timers. Build with MARINE_NAV_METRICS=0 (cmake -DENABLE_METRICS=OFF)
+// and the MARINE_NAV_COUNT / MARINE_NAV_PHASE macros compile to nothing.
+#ifndef MARINE_NAV_METRICS
+#define MARINE_NAV_METRICS 1
+#endif
+
+namespace marine_nav
+{
+    enum class Counter
+    {
+        CanConnectCalls,
+        RejectedOrdering,
+        RejectedOrientation,
+        RejectedVisibility,
+        GeosIntersects,
+        ExactOrientations,
+        GeodesicWeights,
+        HeapPushes,
+        HeapPops,
+        StalePops,
+        Count
+    };
+
+    const size_t kCounterCount = static_cast<size_t>(Counter::Count);
+
+    // One thread's counters. Only the owning thread writes them, so an increment is a relaxed
+    // load/store pair with no contention; readers sum every live block plus those of exited threads.
+    struct CounterBlock
+    {
+        std::atomic<uint64_t> values[kCounterCount];
+        CounterBlock();
+        ~CounterBlock();
+        CounterBlock(const CounterBlock&) = delete;
+        CounterBlock& operator=(const CounterBlock&) = delete;
+    };
+
+    class Metrics
+    {
+        public:
+            static void add(Counter counter, uint64_t amount = 1)
+            {
+                thread_local CounterBlock block;
+                std::atomic<uint64_t>& value = block.values[static_cast<size_t>(counter)];
+                value.store(value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+            }
+            static uint64_t get(Counter counter);
+            static void reset();
+            static const char* counter_name(Counter counter);
+            // Adds one completed phase to the per-phase totals, and to the trace when tracing is on.
+            // Times are microseconds since process start.
+            static void record_phase(const char* name, double begin_us, double end_us);
+            static double now_us();
+            static void set_tracing(bool enabled);
+            static bool is_tracing();
+            static bool is_enabled()
+            {
+                return MARINE_NAV_METRICS != 0;
+            }
+            // {"metrics_enabled": .., "counters": {name: n}, "phases": {name: {"count": n, "total_ms": t}}}
+            static std::string stats_json();
+            static void write_stats(const std::string& filename);
+            // Chrome trace-event JSON (chrome://tracing, Perfetto): one complete event per phase, plus the
+            // final counter values.
+            static void write_trace(const std::string& filename);
+    };
+
+    // Times the enclosing scope as one phase.
+    class ScopedPhase
+    {
+        private:
+            const char* name_;
+            double begin_us_;
+        public:
+            explicit ScopedPhase(const char* name) : name_(name), begin_us_(Metrics::now_us()) {}
+            ~ScopedPhase()
+            {
+                Metrics::record_phase(name_, begin_us_, Metrics::now_us());
+            }
+            ScopedPhase(const ScopedPhase&) = delete;
+            ScopedPhase& operator=(const ScopedPhase&) = delete;
+    };
+}
+
+#define MARINE_NAV_CONCAT_INNER(a, b) a##b
+#define MARINE_NAV_CONCAT(a, b) MARINE_NAV_CONCAT_INNER(a, b)
+#if MARINE_NAV_METRICS
+#define MARINE_NAV_COUNT(counter) ::marine_nav::Metrics::add(::marine_nav::Counter::counter)
+#define MARINE_NAV_COUNT_N(counter, amount) ::marine_nav::Metrics::add(::marine_nav::Counter::counter, amount)
+#define MARINE_NAV_PHASE(name) ::marine_nav::ScopedPhase MARINE_NAV_CONCAT(marine_nav_phase_, __LINE__)(name)
+#else
+#define MARINE_NAV_COUNT(counter) ((void)0)
+#define MARINE_NAV_COUNT_N(counter, amount) ((void)0)
+#define MARINE_NAV_PHASE(name) ((void)0)
+#endif
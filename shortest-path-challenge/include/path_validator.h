@@ -0,0 +1,54 @@
+#pragma once
+#include "geometry.h"
+#include "thread_pool.h"
+#include <climits>
+#include <cstdint>
+#include <memory>
+#include <vector>
+namespace marine_nav
+{
+    // Checks finished routes against one gateway set. prepare() copies the segments into SoA arrays and
+    // maps each endpoint and crossing label to its gateway order; after that a validation allocates
+    // nothing and costs one SIMD pass over the segments per leg, O(P·S) for P points and S segments.
+    //
+    // A route is valid when its gateway orders never decrease and every leg, taken in travel direction,
+    // has each gateway's left end strictly on its left and right end strictly on its right, and crosses
+    // no gateway later than both of its ends. Those are the checks behind every visibility graph edge.
+    //
+    // A continuous route (see ContinuousCrossingSolver) bends on the gateways themselves, so it has its
+    // own rules instead: one point on each gateway in gateway order, each gateway crossed in travel
+    // direction with its left end to port and its right end to starboard, and no leg crossing a gateway
+    // later than its own end.
+    class PathValidator
+    {
+        private:
+            SegmentArrays arrays_;
+            std::vector<int> label_order_;   // by label id; kNoOrder for labels that name no gateway point
+            std::vector<size_t> by_order_;   // segment indices in gateway order
+            SimdLevel simd_level_;
+            size_t thread_count_;
+            std::unique_ptr<ThreadPool> thread_pool_;
+            static constexpr int kNoOrder = INT_MIN;
+            int order_of(uint32_t label_id) const
+            {
+                return label_id < label_order_.size() ? label_order_[label_id] : kNoOrder;
+            }
+        public:
+            PathValidator();
+            void set_simd_level(SimdLevel level) { simd_level_ = level; }
+            SimdLevel get_simd_level() const { return simd_level_; }
+            // Threads used by validate_batch (default 1); 0 = all cores.
+            void set_thread_count(size_t thread_count);
+            void prepare(const std::vector<Segment>& segments);
+            size_t size() const { return arrays_.size(); }
+            // The first point is the start and the last the end. Points that are not gateway endpoints
+            // or crossings keep the order of the gateway before them.
+            bool validate(const std::vector<Point>& path) const;
+            // As above, and the route must begin at start and finish at end.
+            bool validate(const std::vector<Point>& path, const Point& start, const Point& end) const;
+            // The continuous-mode rules above; path is start, one crossing per gateway in order, end.
+            bool validate_crossings(const std::vector<Point>& path, const Point& start, const Point& end) const;
+            // validate() for each path on the validator's thread pool; results keep the input order.
+            std::vector<uint8_t> validate_batch(const std::vector<std::vector<Point>>& paths);
+    };
+}
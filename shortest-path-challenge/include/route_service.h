@@ -0,0 +1,73 @@
+#pragma once
+#include "distance_oracle.h"
+#include "shortest_path.h"
+#include "solver_workspace.h"
+#include "thread_pool.h"
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+namespace marine_nav
+{
+    // Costs, and optionally routes, from every start to every end. Row r holds start r; an unreachable
+    // pair costs infinity and has an unfound PathResult.
+    struct RouteMatrix
+    {
+        size_t rows = 0;
+        size_t cols = 0;
+        std::vector<double> costs;       // row-major, rows * cols
+        std::vector<PathResult> paths;   // row-major; empty when routes were not requested
+        double cost(size_t row, size_t col) const { return costs[row * cols + col]; }
+        const PathResult& path(size_t row, size_t col) const { return paths[row * cols + col]; }
+    };
+
+    // Long-lived solver for many (start, end) queries over one gateway set. The segments are ingested
+    // once and the gateway-to-gateway part of the visibility graph, together with the prepared
+    // geometry caches, stays warm; each query only evaluates the pairs that touch its own start and end.
+    class RouteService
+    {
+        private:
+            std::vector<Segment> segments_;
+            VisibilityGraph graph_;
+            size_t thread_count_;
+            std::unique_ptr<ThreadPool> thread_pool_;
+            std::vector<std::unique_ptr<SolverWorkspace>> workspaces_;   // one per pool worker, for route_batch and route_matrix
+            bool loaded_;
+            DistanceOracle oracle_;
+            std::vector<int> layer_nodes_;      // gateway nodes sorted by gateway order
+            std::vector<size_t> layer_offsets_; // layer k is layer_nodes_[layer_offsets_[k], layer_offsets_[k + 1])
+            PathResult route(const Point& start, const Point& end, const GeometryEngine& engine, SolverWorkspace& workspace) const;
+        public:
+            RouteService();
+            // Configure before load(); the same engine answers every query.
+            GeometryEngine& get_geometry_engine() { return graph_.get_geometry_engine(); }
+            // Threads used both for the gateway graph build and for answering batches; 0 = all cores.
+            void set_thread_count(size_t thread_count);
+            size_t get_thread_count() const { return thread_count_; }
+            void load(const std::vector<Segment>& segments);
+            bool is_loaded() const { return loaded_; }
+            const VisibilityGraph& get_graph() const { return graph_; }
+            const std::vector<Segment>& get_segments() const { return segments_; }
+            // Same route as ShortestPathSolver::solve with Dijkstra on the full graph. Safe to call
+            // concurrently with either intersection backend.
+            PathResult route(const Point& start, const Point& end) const;
+            // Answers the queries on the service's thread pool; results keep the query order.
+            std::vector<PathResult> route_batch(const std::vector<std::pair<Point, Point>>& queries);
+            // Precomputes every gateway-to-gateway distance (see DistanceOracle) on the service's threads,
+            // or maps an oracle file written for the same segments. load() drops the oracle.
+            void build_oracle();
+            void load_oracle(const std::string& filename);
+            const DistanceOracle& get_oracle() const { return oracle_; }
+            // route(start, end)'s total_distance (up to rounding) from the oracle: start is attached to the
+            // first reachable layer and end to the last one, then the cheapest attached pair is looked up.
+            // Nodes on other layers are tested only when their straight-line bound beats that answer, so
+            // it stays exact. No graph search runs. infinity when unreachable; the oracle must be ready.
+            double route_distance(const Point& start, const Point& end) const;
+            // route_distance for each query on the service's thread pool; results keep the query order.
+            std::vector<double> route_distance_batch(const std::vector<std::pair<Point, Point>>& queries);
+            // Many-to-many: the ends are attached once, then each start runs one full search over the
+            // gateway graph that answers its whole row. Starts are spread over the thread pool, and each
+            // cost equals route(start, end)'s. One-to-many is a single start.
+            RouteMatrix route_matrix(const std::vector<Point>& starts, const std::vector<Point>& ends, bool with_paths = true);
+    };
+}
@@ -0,0 +1,100 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+namespace marine_nav
+{
+    struct Segment;
+
+    enum class SimdLevel
+    {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    // Structure-of-arrays copy of the gateway segments so the intersection
+    // kernels can stream coordinates straight into vector registers.
+    struct SegmentArrays
+    {
+        std::vector<double> left_x;
+        std::vector<double> left_y;
+        std::vector<double> right_x;
+        std::vector<double> right_y;
+        std::vector<int> order;
+        // Box around every endpoint; the kernels derive their static orientation error bounds from it.
+        double min_x = std::numeric_limits<double>::infinity();
+        double min_y = std::numeric_limits<double>::infinity();
+        double max_x = -std::numeric_limits<double>::infinity();
+        double max_y = -std::numeric_limits<double>::infinity();
+        void assign(const std::vector<Segment>& segments);
+        void clear();
+        size_t size() const
+        {
+            return order.size();
+        }
+    };
+
+    // First check a node pair fails in the fused constraint pass.
+    enum class ConstraintFailure
+    {
+        None,
+        Orientation,    // a segment's left end is not strictly to port, or its right end not strictly to starboard
+        Visibility      // the pair crosses a later segment
+    };
+
+    class IntersectionKernel
+    {
+        public:
+            static SimdLevel detect_simd_level();
+            static const char* simd_level_name(SimdLevel level);
+            // Relative error bound of orientation's rounded cross product, (3 + 16u)u with u = 2^-53.
+            static constexpr double kOrientationErrorBound = (3.0 + 16.0 * 0x1p-53) * 0x1p-53;
+            // Side of c relative to the directed line a-b: > 0 to port, < 0 to starboard, 0 on the line. The
+            // sign is exact for any inputs that neither overflow nor underflow. The rounded cross product is
+            // returned whenever the error bound settles its sign (Shewchuk's orient2d filter), so only
+            // near-collinear triples pay for orientation_exact.
+            static double orientation(double ax, double ay, double bx, double by, double cx, double cy)
+            {
+                double left = (bx - ax) * (cy - ay);
+                double right = (by - ay) * (cx - ax);
+                double det = left - right;
+                if (std::fabs(det) >= kOrientationErrorBound * (std::fabs(left) + std::fabs(right)))
+                {
+                    return det;
+                }
+                return orientation_exact(ax, ay, bx, by, cx, cy);
+            }
+            // The same determinant summed exactly as an expansion of its six products; returns its largest
+            // component, which carries the exact sign. Counted as Counter::ExactOrientations.
+            static double orientation_exact(double ax, double ay, double bx, double by, double cx, double cy);
+            // Closed segment/segment test (touching counts), same predicate as GEOSIntersects for two lines.
+            static bool segments_intersect(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy);
+            // True if from-to hits any segment i in [begin, end) with order[i] > min_order.
+            static bool any_intersection(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int min_order, SimdLevel level);
+            // Orientation and visibility for every segment in [begin, end) in one pass: each segment's two
+            // cross products are computed once and their signs alone reject the pair; only segments with
+            // order > max_order whose bounding box overlaps from-to get the exact intersection test. Stops at
+            // the first failing segment. Same result as the orientation loop plus any_intersection.
+            static ConstraintFailure first_violation(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int max_order);
+            // first_violation(...) != None, evaluated SIMD-wide: the cross products of 2 or 4 segments per
+            // step, no early exit inside a step. For validating legs whose answer is almost always "none".
+            static bool any_violation(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int max_order, SimdLevel level);
+        private:
+            // Static filters for one leg against every segment of arrays: a SIMD kernel's rounded cross
+            // product against the leg (leg) or against a segment (segment) whose magnitude reaches the
+            // bound has the exact sign. Set up once per call, so each lane pays only a comparison.
+            struct LegBounds
+            {
+                double leg;
+                double segment;
+            };
+            static LegBounds leg_bounds(const SegmentArrays& arrays, double from_x, double from_y, double to_x, double to_y);
+            static bool any_intersection_scalar(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int min_order);
+            static bool any_intersection_sse2(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int min_order);
+            static bool any_intersection_avx2(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int min_order);
+            static bool any_violation_sse2(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int max_order);
+            static bool any_violation_avx2(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int max_order);
+    };
+}
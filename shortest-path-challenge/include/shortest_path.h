@@ -1,39 +1,80 @@
 #pragma once
 #include "visibility_graph.h"
+#include "chart_file.h"
+#include "path_validator.h"
+#include "solver_workspace.h"
+#include <memory>
 #include <vector>
-#include <queue>
 #include <limits>
 namespace marine_nav 
 {
+    class WindowedSolver;
+
     struct PathResult 
     {
         std::vector<Point> path;
         double total_distance;
         bool found;
-        PathResult() : total_distance(std::numeric_limits<double>::infinity()), found(false) {}
+        size_t nodes_settled;
+        PathResult() : total_distance(std::numeric_limits<double>::infinity()), found(false), nodes_settled(0) {}
+    };
+
+    enum class SearchAlgorithm 
+    {
+        Dijkstra,
+        AStar,          // straight-line distance to end
+        AStarCorridor,  // exact remaining distance over the built graph's forward edges; straight-line when lazy
+        LayeredDag,     // forward-only relaxation in gateway order, no priority queue
+        ContinuousCrossing, // crossings anywhere along each gateway, no graph (see ContinuousCrossingSolver)
+        Windowed            // layered sweep in overlapping gateway windows solved in parallel (see WindowedSolver)
     };
 
     class ShortestPathSolver 
     {
         private:
-            struct DijkstraNode 
-            {
-                int node_index;
-                double distance;
-                int previous;
-                DijkstraNode(int idx, double dist, int prev = -1) 
-                    : node_index(idx), distance(dist), previous(prev) {}
-                bool operator>(const DijkstraNode& other) const 
-                {
-                    return distance > other.distance;
-                }
-            };
             VisibilityGraph graph_;
-            std::vector<Point> reconstruct_path(const std::vector<int>& previous, int start_idx, int end_idx) const;
+            bool lazy_graph_;
+            SearchAlgorithm algorithm_;
+            SolverWorkspace workspace_;
+            PathValidator validator_;
+            size_t window_size_;
+            size_t window_overlap_;
+            // Created on the first windowed solve and kept, with its thread pool, for the next ones.
+            std::unique_ptr<WindowedSolver> windowed_;
+            PathResult search(const Point& start, const Point& end);
+            PathResult solve_layered(int start_idx, int end_idx);
+            // Fills workspace_.heuristic() and returns it, or returns nullptr for plain Dijkstra (zero everywhere).
+            const double* compute_heuristic(const Point& end, int end_idx);
+            std::vector<Point> reconstruct_path(int start_idx, int end_idx);
         public:
             ShortestPathSolver();
+            ~ShortestPathSolver();
+            // Lazy mode only evaluates the neighbours of nodes Dijkstra actually settles.
+            void set_lazy_graph(bool lazy) { lazy_graph_ = lazy; }
+            bool is_lazy_graph() const { return lazy_graph_; }
+            void set_search_algorithm(SearchAlgorithm algorithm) { algorithm_ = algorithm; }
+            SearchAlgorithm get_search_algorithm() const { return algorithm_; }
+            // Gateways per window and shared between neighbouring windows for SearchAlgorithm::Windowed.
+            void set_window(size_t window, size_t overlap);
             PathResult solve(const std::vector<Segment>& segments, const Point& start, const Point& end);
+            // Same as solve over a chart loaded with ChartFile::load_segments/get_start/get_end, but an eager
+            // search reuses the chart's precomputed graph instead of evaluating any pair. The chart must
+            // outlive the solver's use of the graph. Throws std::runtime_error when the segment count, start
+            // or end differ from the chart header.
+            PathResult solve(const std::vector<Segment>& segments, const Point& start, const Point& end, const ChartFile& chart);
+            // Up to k loopless routes, shortest first, from one eager graph build (see KShortestPaths). The first
+            // equals solve's distance with Dijkstra; lazy mode and the search algorithm are ignored.
+            std::vector<PathResult> solve_alternatives(const std::vector<Segment>& segments, const Point& start, const Point& end, size_t k);
+            // The windowed solver behind SearchAlgorithm::Windowed, or nullptr before its first solve.
+            const WindowedSolver* get_windowed_solver() const { return windowed_.get(); }
             const VisibilityGraph& get_graph() const { return graph_; }
-            bool validate_path(const std::vector<Point>& path, const std::vector<Segment>& segments, const Point& start, const Point& end) const;
+            VisibilityGraph& get_graph() { return graph_; }
+            // Search scratch reused by every solve on this solver.
+            const SolverWorkspace& get_workspace() const { return workspace_; }
+            // PathValidator::validate over segments with the graph engine's SIMD level. Re-preparing the
+            // validator is O(S) and reuses its storage.
+            bool validate_path(const std::vector<Point>& path, const std::vector<Segment>& segments, const Point& start, const Point& end);
+            // The same for a SearchAlgorithm::ContinuousCrossing route, with PathValidator::validate_crossings.
+            bool validate_crossings(const std::vector<Point>& path, const std::vector<Segment>& segments, const Point& start, const Point& end);
     };
 } 
@@ -0,0 +1,196 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <vector>
+namespace marine_nav
+{
+    // Bump allocator over a list of blocks. reset() rewinds without freeing, and if the last cycle
+    // spilled into extra blocks they are merged into one, so a steady workload stops allocating.
+    class MonotonicArena
+    {
+        private:
+            std::vector<std::unique_ptr<unsigned char[]>> blocks_;
+            std::vector<size_t> block_sizes_;
+            size_t current_;     // block being carved
+            size_t used_;        // bytes taken from blocks_[current_]
+            size_t block_size_;
+            size_t block_allocations_;
+            void add_block(size_t min_bytes);
+        public:
+            explicit MonotonicArena(size_t block_size = 64 * 1024);
+            MonotonicArena(const MonotonicArena&) = delete;
+            MonotonicArena& operator=(const MonotonicArena&) = delete;
+            void* allocate(size_t bytes, size_t alignment);
+            template <typename T>
+            T* allocate_array(size_t count)
+            {
+                return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+            }
+            // Every pointer handed out since the last reset becomes invalid.
+            void reset();
+            // Blocks obtained from the system allocator over the arena's lifetime.
+            size_t get_block_allocations() const
+            {
+                return block_allocations_;
+            }
+    };
+
+    // Min-heap of (key, node) with D children per slot. It is shallower than the binary heap behind
+    // std::priority_queue, and a sift-down scans D adjacent children. clear() keeps the storage.
+    template <size_t D>
+    class DaryHeap
+    {
+        public:
+            struct Entry
+            {
+                double key;
+                int node;
+            };
+            bool empty() const
+            {
+                return entries_.empty();
+            }
+            size_t size() const
+            {
+                return entries_.size();
+            }
+            void clear()
+            {
+                entries_.clear();
+            }
+            void reserve(size_t count)
+            {
+                entries_.reserve(count);
+            }
+            const Entry& top() const
+            {
+                return entries_.front();
+            }
+            void push(double key, int node)
+            {
+                size_t i = entries_.size();
+                entries_.push_back(Entry{key, node});
+                Entry moving = entries_[i];
+                while (i > 0)
+                {
+                    size_t parent = (i - 1) / D;
+                    if (!(moving.key < entries_[parent].key))
+                    {
+                        break;
+                    }
+                    entries_[i] = entries_[parent];
+                    i = parent;
+                }
+                entries_[i] = moving;
+            }
+            void pop()
+            {
+                Entry moving = entries_.back();
+                entries_.pop_back();
+                size_t count = entries_.size();
+                if (count == 0)
+                {
+                    return;
+                }
+                size_t i = 0;
+                while (true)
+                {
+                    size_t first = i * D + 1;
+                    if (first >= count)
+                    {
+                        break;
+                    }
+                    size_t last = first + D < count ? first + D : count;
+                    size_t best = first;
+                    for (size_t c = first + 1; c < last; ++c)
+                    {
+                        if (entries_[c].key < entries_[best].key)
+                        {
+                            best = c;
+                        }
+                    }
+                    if (!(entries_[best].key < moving.key))
+                    {
+                        break;
+                    }
+                    entries_[i] = entries_[best];
+                    i = best;
+                }
+                entries_[i] = moving;
+            }
+        private:
+            std::vector<Entry> entries_;
+    };
+
+    // Per-node search state that one solver reuses across solves. The arrays are carved from an arena
+    // sized for the largest graph seen so far. A generation stamp marks the entries written by the
+    // current solve, so begin() is O(1) and never refills the arrays.
+    class SolverWorkspace
+    {
+        private:
+            MonotonicArena arena_;
+            size_t capacity_;
+            uint32_t generation_;
+            uint32_t* stamp_;
+            double* distance_;
+            int* previous_;
+            double* settled_;    // distance at which the node was last expanded
+            double* heuristic_;
+            void touch(int node)
+            {
+                if (stamp_[node] != generation_)
+                {
+                    stamp_[node] = generation_;
+                    distance_[node] = std::numeric_limits<double>::infinity();
+                    previous_[node] = -1;
+                    settled_[node] = std::numeric_limits<double>::infinity();
+                }
+            }
+        public:
+            DaryHeap<4> heap;
+            std::vector<int> order;   // scratch: layered sweep order, path reconstruction
+            SolverWorkspace();
+            SolverWorkspace(const SolverWorkspace&) = delete;
+            SolverWorkspace& operator=(const SolverWorkspace&) = delete;
+            // Starts a solve over node_count nodes: every node reads as unreached and the heap is empty.
+            void begin(size_t node_count);
+            double distance(int node) const
+            {
+                return stamp_[node] == generation_ ? distance_[node] : std::numeric_limits<double>::infinity();
+            }
+            int previous(int node) const
+            {
+                return stamp_[node] == generation_ ? previous_[node] : -1;
+            }
+            double settled(int node) const
+            {
+                return stamp_[node] == generation_ ? settled_[node] : std::numeric_limits<double>::infinity();
+            }
+            void set_distance(int node, double distance, int previous)
+            {
+                touch(node);
+                distance_[node] = distance;
+                previous_[node] = previous;
+            }
+            void set_settled(int node, double distance)
+            {
+                touch(node);
+                settled_[node] = distance;
+            }
+            // Uninitialized array of begin()'s node_count entries for the solver's heuristic.
+            double* heuristic()
+            {
+                return heuristic_;
+            }
+            size_t get_capacity() const
+            {
+                return capacity_;
+            }
+            size_t get_block_allocations() const
+            {
+                return arena_.get_block_allocations();
+            }
+    };
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "segment_kernels.h"
+#include <cstdint>
+#include <vector>
+namespace marine_nav
+{
+    struct Segment;
+
+    // Packed Sort-Tile-Recursive R-tree over the gateway segments. Leaves cover contiguous runs of
+    // an STR-ordered SegmentArrays copy, so a leaf that survives the envelope test goes straight to
+    // the SIMD intersection kernel.
+    class SegmentIndex
+    {
+        private:
+            struct Node
+            {
+                double min_x, min_y, max_x, max_y;
+                uint32_t first;   // first child node, or first entry of arrays_ for a leaf
+                uint32_t count;
+                bool leaf;
+            };
+            SegmentArrays arrays_;
+            std::vector<int> segment_ids_;   // arrays_ slot -> index into the source vector
+            std::vector<Node> nodes_;        // levels stored bottom-up, root last
+            size_t node_capacity_;
+            static bool node_misses_line(const Node& node, double from_x, double from_y, double to_x, double to_y);
+        public:
+            // Capacity is clamped to [2, 32] so traversal fits a fixed-size stack.
+            explicit SegmentIndex(size_t node_capacity = 8);
+            void build(const std::vector<Segment>& segments);
+            void clear();
+            size_t size() const
+            {
+                return arrays_.size();
+            }
+            const SegmentArrays& get_arrays() const
+            {
+                return arrays_;
+            }
+            // Appends the source indices of every segment whose envelope overlaps the box.
+            void query(double min_x, double min_y, double max_x, double max_y, std::vector<int>& out) const;
+            // Same predicate as IntersectionKernel::any_intersection over all segments with order > min_order,
+            // but only leaves whose envelope overlaps the query segment and straddles its line are tested.
+            bool any_intersection(double from_x, double from_y, double to_x, double to_y, int min_order, SimdLevel level) const;
+    };
+
+    // Packed STR tree over the edges of an incremental visibility graph, answering which edges a new
+    // segment may block. Each edge is kept as its supporting line in normal form (direction angle theta,
+    // offset rho along the port normal) and packed by (theta, rho), so a node covers similar lines and
+    // one bound on the segment ends tells whether all of them keep the left end strictly to port and the
+    // right end strictly to starboard. The node's box handles the crossing test.
+    class EdgeIndex
+    {
+        public:
+            struct Edge
+            {
+                uint64_t key;
+                double from_x, from_y, to_x, to_y;   // in travel direction
+            };
+        private:
+            struct Entry
+            {
+                double theta, rho;
+                double min_x, min_y, max_x, max_y;
+                uint64_t key;
+            };
+            struct Node
+            {
+                double theta_min, theta_max, rho_min, rho_max;
+                double min_x, min_y, max_x, max_y;
+                uint32_t first;   // first child node, or first entry for a leaf
+                uint32_t count;
+                bool leaf;
+            };
+            std::vector<Entry> entries_;
+            std::vector<uint64_t> degenerate_;   // zero-length edges, which every segment blocks
+            std::vector<Node> nodes_;
+            size_t node_capacity_;
+            static bool may_block(const Node& node, const Segment& segment);
+        public:
+            explicit EdgeIndex(size_t node_capacity = 8);
+            void build(const std::vector<Edge>& edges);
+            void clear();
+            size_t size() const
+            {
+                return entries_.size() + degenerate_.size();
+            }
+            // Appends the key of every edge that segment may block, by orientation or by crossing, as
+            // VisibilityGraph::segment_blocks decides it; edges that are left out are certainly not blocked.
+            void query(const Segment& segment, std::vector<uint64_t>& out) const;
+    };
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+namespace marine_nav
+{
+    // Fixed-size pool with one range deque per worker. Workers pop from the back of
+    // their own deque and steal from the front of the others once they run dry.
+    class ThreadPool
+    {
+        public:
+            using RangeTask = std::function<void(size_t begin, size_t end, size_t worker)>;
+            explicit ThreadPool(size_t thread_count);
+            ~ThreadPool();
+            ThreadPool(const ThreadPool&) = delete;
+            ThreadPool& operator=(const ThreadPool&) = delete;
+            size_t size() const
+            {
+                return queues_.size();
+            }
+            // Runs task over [0, count) in chunks of grain; blocks until every chunk is done.
+            // The calling thread takes part as worker 0. If a chunk throws, the chunks not yet started
+            // are skipped, every worker still finishes, and the first exception is rethrown here.
+            void parallel_for(size_t count, size_t grain, const RangeTask& task);
+            static size_t resolve_thread_count(size_t requested);
+        private:
+            struct WorkQueue
+            {
+                std::mutex mutex;
+                std::deque<std::pair<size_t, size_t>> ranges;
+            };
+            std::vector<std::unique_ptr<WorkQueue>> queues_;
+            std::vector<std::thread> threads_;
+            std::mutex state_mutex_;
+            std::condition_variable work_ready_;
+            std::condition_variable work_done_;
+            const RangeTask* task_;
+            size_t generation_;
+            size_t active_workers_;
+            std::atomic<size_t> pending_ranges_;
+            std::atomic<bool> failed_;
+            std::exception_ptr error_;
+            bool stopping_;
+            void worker_loop(size_t worker);
+            void drain(size_t worker);
+            bool pop_range(size_t worker, std::pair<size_t, size_t>& range);
+    };
+}
@@ -1,5 +1,9 @@
 #pragma once
 #include "geometry.h"
+#include "geodesic.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <memory>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -22,21 +26,173 @@ namespace marine_nav
         GraphEdge(int from, int to, double w) : from_node(from), to_node(to), weight(w) {}
     };
 
+    // One adjacency row in the CSR arrays: targets[k] is reached at cost weights[k].
+    struct NeighborRange 
+    {
+        const int* targets;
+        const double* weights;
+        size_t count;
+        size_t size() const 
+        {
+            return count;
+        }
+    };
+
+    // The entries of node's row above node. Pairs are checked from the lower index to the higher one
+    // and rows are sorted by target, so these are the edges a route may leave node by.
+    inline NeighborRange forward_part(const NeighborRange& row, int node) 
+    {
+        size_t skipped = static_cast<size_t>(std::upper_bound(row.targets, row.targets + row.count, node) - row.targets);
+        return NeighborRange{row.targets + skipped, row.weights + skipped, row.count - skipped};
+    }
+
     class VisibilityGraph 
     {
         private:
             std::vector<GraphNode> nodes_;
-            std::vector<std::vector<GraphEdge>> adjacency_list_;
+            // Compressed sparse rows: row i is [offsets_[i], offsets_[i + 1]) of targets_/weights_,
+            // sorted by target. Lazy rows are appended in expansion order and located via lazy_row_begin_.
+            std::vector<size_t> offsets_;
+            std::vector<int> targets_;
+            std::vector<double> weights_;
+            // Eager rows are read through these; they point at the vectors above, or into a chart
+            // file for a graph adopted with attach_graph.
+            const size_t* row_offsets_;
+            const int* row_targets_;
+            const double* row_weights_;
+            size_t row_entry_count_;
+            bool attached_;
+            std::vector<size_t> lazy_row_begin_;
+            std::vector<size_t> lazy_row_end_;
+            mutable std::vector<std::vector<GraphEdge>> adjacency_view_;
+            mutable bool adjacency_view_valid_;
             GeometryEngine geometry_engine_;
+            size_t thread_count_;
+            std::unique_ptr<ThreadPool> thread_pool_;
+            const std::vector<Segment>* segments_;
+            bool lazy_;
+            bool fused_constraints_;
+            std::vector<char> expanded_;
+            size_t pairs_evaluated_;
+            // Build scratch kept between builds so a rebuild of a similar graph reuses its capacity.
+            std::vector<GraphEdge> edge_scratch_;
+            std::vector<size_t> cursor_scratch_;
+            std::vector<std::vector<GraphEdge>> worker_edges_;
+            const LocalProjection* projection_;
+            GeodesicNodes geodesic_nodes_;
+            void reset(const std::vector<Segment>& segments, bool prepare_geometry = true);
+            void create_nodes(const std::vector<Segment>& segments, const Point& start, const Point& end, bool prepare_geometry = true);
             bool can_connect_nodes(const GraphNode& from, const GraphNode& to, const std::vector<Segment>& segments) const;
+            bool can_connect_nodes(const GraphNode& from, const GraphNode& to, const std::vector<Segment>& segments, const GeometryEngine& engine) const;
+            void build_edges_serial(const std::vector<Segment>& segments);
+            void build_edges_parallel(const std::vector<Segment>& segments);
+            // pairs must be sorted by (from_node, to_node) with from_node < to_node.
+            void assemble_csr(const std::vector<GraphEdge>& pairs);
+            // Unit vectors of the nodes' unprojected points, or nothing for planar input.
+            void prepare_geodesic();
+            // Great-circle weights for entries [begin, end) of targets_/weights_, all in node's row.
+            void apply_geodesic_weights(int node, size_t begin, size_t end);
             bool respects_ordering_constraint(const GraphNode& from, const GraphNode& to) const;
             bool respects_orientation_constraint(const GraphNode& from, const GraphNode& to, const std::vector<Segment>& segments) const;
         public:
             VisibilityGraph();
             void build_graph(const std::vector<Segment>& segments, const Point& start, const Point& end);
-            const std::vector<std::vector<GraphEdge>>& get_adjacency_list() const 
+            // Gateway endpoints only (node 2k is the left end of the k-th segment, 2k + 1 its right end).
+            // These edges do not depend on start or end, so one build can serve many queries.
+            void build_gateway_graph(const std::vector<Segment>& segments);
+            // Runs the build's constraint checks for one ordered pair; from plays the lower node index.
+            bool can_connect(const GraphNode& from, const GraphNode& to, const GeometryEngine& engine) const;
+            // Adopts CSR rows previously built by build_graph for the same segments, start and end (see ChartFile).
+            // No pair is evaluated and the arrays are not copied, so they must outlive the graph's use.
+            void attach_graph(const std::vector<Segment>& segments, const Point& start, const Point& end, 
+                              const size_t* offsets, const int* targets, const double* weights);
+            // Creates the nodes only; edges are evaluated per node by get_neighbors. segments must outlive the search.
+            void build_lazy(const std::vector<Segment>& segments, const Point& start, const Point& end);
+            // Row of node; in lazy mode the row is computed and memoized on first access.
+            // The range stays valid until the next get_neighbors or build call.
+            NeighborRange get_neighbors(int node);
+            // Stored row without triggering lazy expansion (empty for unexpanded lazy nodes).
+            NeighborRange get_row(int node) const;
+            // Tests one pair with the same constraint checks as the eager build (counted in pairs evaluated).
+            bool evaluate_pair(int a, int b);
+            // Weight the build gives the edge between nodes a and b: the engine's distance, or the
+            // great-circle distance under a projection.
+            double edge_weight(int a, int b) const;
+            bool is_lazy() const
+            {
+                return lazy_;
+            }
+            bool is_attached() const
+            {
+                return attached_;
+            }
+            size_t get_pairs_evaluated() const
+            {
+                return pairs_evaluated_;
+            }
+            size_t get_eager_pair_count() const
+            {
+                return nodes_.size() * (nodes_.size() - (nodes_.empty() ? 0 : 1)) / 2;
+            }
+            // 1 keeps the serial build, 0 uses every hardware thread.
+            void set_thread_count(size_t thread_count);
+            // On by default: the native backend checks orientation and crossings in one pass per pair
+            // (GeometryEngine::check_constraints). Off runs the original staged checks for comparison.
+            void set_fused_constraints(bool fused)
+            {
+                fused_constraints_ = fused;
+            }
+            bool uses_fused_constraints() const
+            {
+                return fused_constraints_;
+            }
+            size_t get_thread_count() const
+            {
+                return thread_count_;
+            }
+            // Geographic input: node points are planar coordinates from projection, and every edge weight
+            // built from then on is the great-circle distance between the unprojected ends, computed a row
+            // at a time (GeodesicKernel::row_distances). nullptr, the default, keeps planar weights. The
+            // projection must outlive the graph's builds; attached graphs keep their stored weights.
+            void set_projection(const LocalProjection* projection)
+            {
+                projection_ = projection;
+            }
+            const LocalProjection* get_projection() const
+            {
+                return projection_;
+            }
+            // Compatibility view materialized from the CSR arrays on first use after a change.
+            const std::vector<std::vector<GraphEdge>>& get_adjacency_list() const;
+            // Undirected edge count of an eager build.
+            size_t get_edge_count() const 
+            {
+                return (lazy_ ? targets_.size() : row_entry_count_) / 2;
+            }
+            // Raw CSR arrays of an eager build: get_node_count() + 1 offsets and get_row_entry_count() entries.
+            const size_t* get_row_offsets() const
+            {
+                return row_offsets_;
+            }
+            const int* get_row_targets() const
+            {
+                return row_targets_;
+            }
+            const double* get_row_weights() const
+            {
+                return row_weights_;
+            }
+            size_t get_row_entry_count() const
+            {
+                return row_entry_count_;
+            }
+            GeometryEngine& get_geometry_engine()
+            {
+                return geometry_engine_;
+            }
+            const GeometryEngine& get_geometry_engine() const
             {
-                return adjacency_list_;
+                return geometry_engine_;
             }
             const GraphNode& get_node(int index) const 
             {
@@ -46,7 +202,12 @@ namespace marine_nav
             {
                 return nodes_.size();
             }
+            // can_connect holds exactly when ordering_allows(from, to) and no segment blocks the pair, which
+            // lets IncrementalVisibilityGraph re-check a single changed segment instead of rebuilding.
+            static bool ordering_allows(const GraphNode& from, const GraphNode& to);
+            static bool segment_blocks(const GraphNode& from, const GraphNode& to, const Segment& segment);
             int find_node_index(const std::string& label) const;
+            int find_node_index(uint32_t label_id) const;
             void print_graph() const;
     };
 } 
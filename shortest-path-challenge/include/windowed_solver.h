@@ -0,0 +1,57 @@
+#pragma once
+#include "shortest_path.h"
+#include "thread_pool.h"
+#include <memory>
+#include <vector>
+namespace marine_nav
+{
+    // Layered sweep (SearchAlgorithm::LayeredDag) over a long gateway chain cut into windows of W
+    // consecutive gateways, each overlapping the next by L. Windows are independent: each one finds
+    // the shortest forward routes inside it from every node of its first L gateways (the band it shares
+    // with the previous window) to every node of its last L. Those small band-to-band tables are then
+    // chained with min-plus steps, and the route is read back from the predecessors kept for the chosen
+    // entries, with no second sweep.
+    //
+    // The pair checks are the full ones (every segment, on the graph's prepared engine), so every leg
+    // is a legal edge. Only routes that visit every band are chained, plus the direct start-end leg,
+    // which is checked on its own. The result equals solve_layered's whenever no leg of that optimum
+    // skips a whole band; otherwise it is a legal route that may be longer, and get_error_bound() says
+    // by how much at most. When no route visits every band and the direct leg is blocked, nothing is
+    // found. Working memory is O(threads · W² + S · L), not O(S²).
+    class WindowedSolver
+    {
+        private:
+            VisibilityGraph& graph_;
+            size_t window_;
+            size_t overlap_;
+            size_t thread_count_;
+            size_t window_count_;
+            size_t pairs_evaluated_;
+            double error_bound_;
+            std::unique_ptr<ThreadPool> thread_pool_;
+            struct Window;
+            // Layers [first_layer, last_layer), plus start when first_layer is 0 and end when last_layer is
+            // the last; bands are the first and last L layers of the range.
+            Window make_window(size_t first_layer, size_t last_layer, const std::vector<std::vector<int>>& layers) const;
+            // Layered sweep inside window from the node at position source; fills distances and
+            // predecessors over the window's positions and returns the number of pairs evaluated. An empty
+            // pair_cache evaluates every pair without caching it.
+            size_t sweep(const Window& window, size_t source, std::vector<double>& distances, std::vector<int>& previous,
+                         std::vector<signed char>& pair_cache) const;
+        public:
+            // graph supplies the nodes and the configured engine; solve() rebuilds it lazily.
+            explicit WindowedSolver(VisibilityGraph& graph);
+            // window gateways per window, overlap gateways shared with the next; window >= 2 * overlap >= 2.
+            void set_window(size_t window, size_t overlap);
+            // The pool is kept across solves and rebuilt only when the count changes.
+            void set_thread_count(size_t thread_count);
+            PathResult solve(const std::vector<Segment>& segments, const Point& start, const Point& end);
+            size_t get_window_count() const { return window_count_; }
+            size_t get_pairs_evaluated() const { return pairs_evaluated_; }
+            // How much longer the last solve's route can be than solve_layered's: 0 when it is certainly
+            // the same (one window, or the direct leg), infinity when nothing was found over several
+            // windows (a route that skips a band may still exist), otherwise the distance above the
+            // straight start-end leg.
+            double get_error_bound() const { return error_bound_; }
+    };
+}
@@ -0,0 +1,302 @@
+#include "chart_file.h"
+#include "visibility_graph.h"
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+namespace marine_nav
+{
+    static_assert(sizeof(ChartHeader) == 96, "ChartHeader layout must not change within a version");
+    static_assert(sizeof(size_t) == sizeof(uint64_t), "chart row offsets are read in place as size_t");
+    static_assert(sizeof(int) == sizeof(int32_t), "chart targets are read in place as int");
+
+    namespace
+    {
+        const char kMagic[8] = {'M', 'N', 'C', 'H', 'A', 'R', 'T', '\0'};
+
+        bool host_is_little_endian()
+        {
+            const uint16_t probe = 1;
+            unsigned char first;
+            std::memcpy(&first, &probe, 1);
+            return first == 1;
+        }
+
+        size_t align8(size_t offset)
+        {
+            return (offset + 7) & ~static_cast<size_t>(7);
+        }
+
+        // Byte offsets of each section for the counts in header.
+        struct ChartLayout
+        {
+            size_t left_x, left_y, right_x, right_y, order, left_label, right_label;
+            size_t label_offsets, label_chars;
+            size_t row_offsets, weights, targets;
+            size_t total;
+            explicit ChartLayout(const ChartHeader& header)
+            {
+                size_t s = static_cast<size_t>(header.segment_count);
+                left_x = sizeof(ChartHeader);
+                left_y = left_x + s * sizeof(double);
+                right_x = left_y + s * sizeof(double);
+                right_y = right_x + s * sizeof(double);
+                order = right_y + s * sizeof(double);
+                left_label = order + s * sizeof(int32_t);
+                right_label = left_label + s * sizeof(uint32_t);
+                label_offsets = align8(right_label + s * sizeof(uint32_t));
+                label_chars = label_offsets + (static_cast<size_t>(header.label_count) + 1) * sizeof(uint64_t);
+                row_offsets = align8(label_chars + static_cast<size_t>(header.label_bytes));
+                total = row_offsets;
+                weights = targets = row_offsets;
+                if (header.flags & ChartFile::kHasGraph)
+                {
+                    weights = row_offsets + (static_cast<size_t>(header.node_count) + 1) * sizeof(uint64_t);
+                    targets = weights + static_cast<size_t>(header.entry_count) * sizeof(double);
+                    total = align8(targets + static_cast<size_t>(header.entry_count) * sizeof(int32_t));
+                }
+            }
+        };
+
+        class ChartWriter
+        {
+            private:
+                std::ofstream& out_;
+                size_t written_;
+            public:
+                explicit ChartWriter(std::ofstream& out) : out_(out), written_(0) {}
+                void bytes(const void* data, size_t size)
+                {
+                    out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(size));
+                    written_ += size;
+                }
+                template <typename T>
+                void array(const std::vector<T>& values)
+                {
+                    bytes(values.data(), values.size() * sizeof(T));
+                }
+                void pad_to(size_t offset)
+                {
+                    static const char zeros[8] = {};
+                    bytes(zeros, offset - written_);
+                }
+        };
+    }
+
+    bool ChartFile::is_chart_file(const std::string& filename)
+    {
+        std::ifstream file(filename, std::ios::binary);
+        char magic[sizeof(kMagic)] = {};
+        return file.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+    }
+
+    void ChartFile::write(const std::string& filename, const std::vector<Segment>& segments, const Point& start, const Point& end,
+                          const VisibilityGraph* graph)
+    {
+        if (!host_is_little_endian())
+        {
+            throw std::runtime_error("Chart files can only be written on little-endian hosts");
+        }
+        if (graph && (graph->is_lazy() || graph->get_node_count() != 2 * segments.size() + 2))
+        {
+            throw std::runtime_error("Chart graph must be an eager build over the chart's segments");
+        }
+        // Chart label ids are dense over the labels this chart uses, independent of the process-wide table.
+        std::vector<const std::string*> labels;
+        std::unordered_map<uint32_t, uint32_t> label_ids;
+        auto intern = [&](const Point& point)
+        {
+            auto inserted = label_ids.emplace(point.label_id, static_cast<uint32_t>(labels.size()));
+            if (inserted.second)
+            {
+                labels.push_back(&point.label());
+            }
+            return inserted.first->second;
+        };
+        size_t s = segments.size();
+        std::vector<double> left_x(s), left_y(s), right_x(s), right_y(s);
+        std::vector<int32_t> order(s);
+        std::vector<uint32_t> left_label(s), right_label(s);
+        for (size_t i = 0; i < s; ++i)
+        {
+            const Segment& segment = segments[i];
+            left_x[i] = segment.left.x;
+            left_y[i] = segment.left.y;
+            right_x[i] = segment.right.x;
+            right_y[i] = segment.right.y;
+            order[i] = segment.order;
+            left_label[i] = intern(segment.left);
+            right_label[i] = intern(segment.right);
+        }
+        ChartHeader header = {};
+        std::memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.start_x = start.x;
+        header.start_y = start.y;
+        header.end_x = end.x;
+        header.end_y = end.y;
+        header.start_label = intern(start);
+        header.end_label = intern(end);
+        std::vector<uint64_t> label_offsets(1, 0);
+        for (const auto* label : labels)
+        {
+            label_offsets.push_back(label_offsets.back() + label->size());
+        }
+        header.segment_count = s;
+        header.label_count = labels.size();
+        header.label_bytes = label_offsets.back();
+        if (graph)
+        {
+            header.flags |= kHasGraph;
+            header.node_count = graph->get_node_count();
+            header.entry_count = graph->get_row_entry_count();
+        }
+        ChartLayout layout(header);
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Could not create chart file: " + filename);
+        }
+        ChartWriter writer(file);
+        writer.bytes(&header, sizeof(header));
+        writer.array(left_x);
+        writer.array(left_y);
+        writer.array(right_x);
+        writer.array(right_y);
+        writer.array(order);
+        writer.array(left_label);
+        writer.array(right_label);
+        writer.pad_to(layout.label_offsets);
+        writer.array(label_offsets);
+        for (const auto* label : labels)
+        {
+            writer.bytes(label->data(), label->size());
+        }
+        writer.pad_to(layout.row_offsets);
+        if (graph)
+        {
+            size_t entries = graph->get_row_entry_count();
+            writer.bytes(graph->get_row_offsets(), (graph->get_node_count() + 1) * sizeof(uint64_t));
+            writer.bytes(graph->get_row_weights(), entries * sizeof(double));
+            writer.bytes(graph->get_row_targets(), entries * sizeof(int32_t));
+            writer.pad_to(layout.total);
+        }
+        if (!file)
+        {
+            throw std::runtime_error("Could not write chart file: " + filename);
+        }
+    }
+
+    ChartFile::ChartFile(const std::string& filename)
+        : file_(filename), header_(nullptr), left_x_(nullptr), left_y_(nullptr), right_x_(nullptr), right_y_(nullptr), order_(nullptr),
+          left_label_(nullptr), right_label_(nullptr), label_offsets_(nullptr), label_chars_(nullptr), row_offsets_(nullptr),
+          weights_(nullptr), targets_(nullptr)
+    {
+        if (!host_is_little_endian())
+        {
+            throw std::runtime_error("Chart files can only be read on little-endian hosts");
+        }
+        if (file_.size() < sizeof(ChartHeader) || std::memcmp(file_.data(), kMagic, sizeof(kMagic)) != 0)
+        {
+            throw std::runtime_error("Not a chart file: " + filename);
+        }
+        header_ = reinterpret_cast<const ChartHeader*>(file_.data());
+        if (header_->version != kVersion)
+        {
+            throw std::runtime_error("Unsupported chart version " + std::to_string(header_->version) + " in " + filename);
+        }
+        uint64_t limit = file_.size();
+        if (header_->segment_count > limit || header_->label_count > limit || header_->label_bytes > limit 
+            || header_->node_count > limit || header_->entry_count > limit)
+        {
+            throw std::runtime_error("Chart file has inconsistent counts: " + filename);
+        }
+        ChartLayout layout(*header_);
+        if (layout.total != file_.size())
+        {
+            throw std::runtime_error("Chart file is truncated or has inconsistent counts: " + filename);
+        }
+        const char* base = file_.data();
+        left_x_ = reinterpret_cast<const double*>(base + layout.left_x);
+        left_y_ = reinterpret_cast<const double*>(base + layout.left_y);
+        right_x_ = reinterpret_cast<const double*>(base + layout.right_x);
+        right_y_ = reinterpret_cast<const double*>(base + layout.right_y);
+        order_ = reinterpret_cast<const int32_t*>(base + layout.order);
+        left_label_ = reinterpret_cast<const uint32_t*>(base + layout.left_label);
+        right_label_ = reinterpret_cast<const uint32_t*>(base + layout.right_label);
+        label_offsets_ = reinterpret_cast<const uint64_t*>(base + layout.label_offsets);
+        label_chars_ = base + layout.label_chars;
+        bool labels_valid = label_offsets_[0] == 0 && label_offsets_[header_->label_count] == header_->label_bytes;
+        for (uint64_t i = 0; labels_valid && i < header_->label_count; ++i)
+        {
+            labels_valid = label_offsets_[i] <= label_offsets_[i + 1];
+        }
+        if (!labels_valid)
+        {
+            throw std::runtime_error("Chart label table is corrupt: " + filename);
+        }
+        if (has_graph())
+        {
+            // One pass over the rows and one over the targets, so every row lies inside the entry
+            // arrays and every target names a node; searches then index without further checks.
+            row_offsets_ = reinterpret_cast<const uint64_t*>(base + layout.row_offsets);
+            weights_ = reinterpret_cast<const double*>(base + layout.weights);
+            targets_ = reinterpret_cast<const int32_t*>(base + layout.targets);
+            bool rows_valid = header_->node_count == 2 * header_->segment_count + 2 && row_offsets_[0] == 0
+                              && row_offsets_[header_->node_count] == header_->entry_count;
+            for (uint64_t i = 0; rows_valid && i < header_->node_count; ++i)
+            {
+                rows_valid = row_offsets_[i] <= row_offsets_[i + 1];
+            }
+            for (uint64_t k = 0; rows_valid && k < header_->entry_count; ++k)
+            {
+                rows_valid = targets_[k] >= 0 && static_cast<uint64_t>(targets_[k]) < header_->node_count;
+            }
+            if (!rows_valid)
+            {
+                throw std::runtime_error("Chart graph rows are corrupt: " + filename);
+            }
+        }
+    }
+
+    std::string ChartFile::get_label(uint32_t id) const
+    {
+        if (id >= header_->label_count)
+        {
+            throw std::runtime_error("Chart label id out of range: " + std::to_string(id));
+        }
+        return std::string(label_chars_ + label_offsets_[id], static_cast<size_t>(label_offsets_[id + 1] - label_offsets_[id]));
+    }
+
+    Point ChartFile::get_start() const
+    {
+        return Point(get_label(header_->start_label), header_->start_x, header_->start_y);
+    }
+
+    Point ChartFile::get_end() const
+    {
+        return Point(get_label(header_->end_label), header_->end_x, header_->end_y);
+    }
+
+    std::vector<Segment> ChartFile::load_segments() const
+    {
+        // Each chart label is interned once, then segments are assembled from ids.
+        std::vector<uint32_t> label_ids(get_label_count());
+        for (uint32_t id = 0; id < label_ids.size(); ++id)
+        {
+            label_ids[id] = LabelTable::global().intern(get_label(id));
+        }
+        std::vector<Segment> segments;
+        segments.reserve(get_segment_count());
+        for (size_t i = 0; i < get_segment_count(); ++i)
+        {
+            if (left_label_[i] >= label_ids.size() || right_label_[i] >= label_ids.size())
+            {
+                throw std::runtime_error("Chart label id out of range in segment " + std::to_string(i));
+            }
+            segments.emplace_back(Point(label_ids[left_label_[i]], left_x_[i], left_y_[i]),
+                                  Point(label_ids[right_label_[i]], right_x_[i], right_y_[i]), order_[i]);
+        }
+        return segments;
+    }
+}
@@ -0,0 +1,160 @@
+#include "continuous_crossing.h"
+#include <algorithm>
+#include <utility>
+namespace marine_nav
+{
+    namespace
+    {
+        double cross(const Point& a, const Point& b, const Point& c)
+        {
+            return IntersectionKernel::orientation(a.x, a.y, b.x, b.y, c.x, c.y);
+        }
+
+        bool same_position(const Point& a, const Point& b)
+        {
+            return a.x == b.x && a.y == b.y;
+        }
+    }
+
+    ContinuousCrossingSolver::ContinuousCrossingSolver() : max_sweeps_(100), tolerance_(1e-12), last_sweeps_(0), last_converged_(false) {}
+
+    double ContinuousCrossingSolver::path_length(const std::vector<Point>& path)
+    {
+        double length = 0.0;
+        for (size_t i = 0; i + 1 < path.size(); ++i)
+        {
+            length += path[i].distance_to(path[i + 1]);
+        }
+        return length;
+    }
+
+    std::vector<Point> ContinuousCrossingSolver::string_pull(const std::vector<const Segment*>& gateways, const Point& start, const Point& end) const
+    {
+        // Portal 0 is start, portals 1..S are the gateways and portal S + 1 is end. The funnel keeps an
+        // apex and the tightest left and right rays seen so far; when one side crosses the other the
+        // blocking corner becomes the new apex and the sweep restarts just past it.
+        size_t portal_count = gateways.size() + 2;
+        auto portal_left = [&](size_t i) -> const Point&
+        {
+            return i == 0 ? start : (i == portal_count - 1 ? end : gateways[i - 1]->left);
+        };
+        auto portal_right = [&](size_t i) -> const Point&
+        {
+            return i == 0 ? start : (i == portal_count - 1 ? end : gateways[i - 1]->right);
+        };
+        std::vector<std::pair<size_t, const Point*>> bends;
+        bends.emplace_back(0, &start);
+        const Point* apex = &start;
+        const Point* funnel_left = &start;
+        const Point* funnel_right = &start;
+        size_t left_index = 0;
+        size_t right_index = 0;
+        for (size_t i = 1; i < portal_count; ++i)
+        {
+            const Point& left = portal_left(i);
+            const Point& right = portal_right(i);
+            if (cross(*apex, *funnel_right, right) >= 0)
+            {
+                if (same_position(*apex, *funnel_right) || cross(*apex, *funnel_left, right) < 0)
+                {
+                    funnel_right = &right;
+                    right_index = i;
+                }
+                else
+                {
+                    apex = funnel_left;
+                    bends.emplace_back(left_index, apex);
+                    funnel_right = apex;
+                    right_index = left_index;
+                    i = left_index;
+                    continue;
+                }
+            }
+            if (cross(*apex, *funnel_left, left) <= 0)
+            {
+                if (same_position(*apex, *funnel_left) || cross(*apex, *funnel_right, left) > 0)
+                {
+                    funnel_left = &left;
+                    left_index = i;
+                }
+                else
+                {
+                    apex = funnel_right;
+                    bends.emplace_back(right_index, apex);
+                    funnel_left = apex;
+                    left_index = right_index;
+                    i = right_index;
+                    continue;
+                }
+            }
+        }
+        if (bends.back().first != portal_count - 1)
+        {
+            bends.emplace_back(portal_count - 1, &end);
+        }
+        // Every gateway between two bends is crossed where the straight leg meets it.
+        std::vector<Point> crossings;
+        crossings.reserve(portal_count);
+        crossings.push_back(start);
+        size_t leg = 0;
+        for (size_t i = 1; i + 1 < portal_count; ++i)
+        {
+            while (bends[leg + 1].first < i)
+            {
+                ++leg;
+            }
+            if (bends[leg + 1].first == i)
+            {
+                crossings.push_back(*bends[leg + 1].second);
+            }
+            else
+            {
+                crossings.push_back(gateways[i - 1]->get_optimal_crossing_point(*bends[leg].second, *bends[leg + 1].second));
+            }
+        }
+        crossings.push_back(end);
+        return crossings;
+    }
+
+    PathResult ContinuousCrossingSolver::solve(const std::vector<Segment>& segments, const Point& start, const Point& end)
+    {
+        PathResult result;
+        std::vector<const Segment*> gateways;
+        gateways.reserve(segments.size());
+        for (const auto& segment : segments)
+        {
+            gateways.push_back(&segment);
+        }
+        std::stable_sort(gateways.begin(), gateways.end(), [](const Segment* a, const Segment* b)
+        {
+            return a->order < b->order;
+        });
+        std::vector<Point> path = string_pull(gateways, start, end);
+        double length = path_length(path);
+        // Each move picks the best point on one gateway given its neighbours, so no sweep lengthens the
+        // route. Stop once a sweep gains less than the tolerance; that is a stall, not a certified minimum.
+        last_sweeps_ = 0;
+        last_converged_ = false;
+        while (last_sweeps_ < max_sweeps_)
+        {
+            ++last_sweeps_;
+            for (size_t i = 1; i + 1 < path.size(); ++i)
+            {
+                path[i] = gateways[i - 1]->get_optimal_crossing_point(path[i - 1], path[i + 1]);
+            }
+            double swept = path_length(path);
+            bool converged = length - swept <= tolerance_ * std::max(1.0, length);
+            length = swept;
+            if (converged)
+            {
+                last_converged_ = true;
+                break;
+            }
+        }
+        result.path = std::move(path);
+        result.total_distance = length;
+        result.found = true;
+        result.nodes_settled = result.path.size();
+        return result;
+    }
+}
@@ -0,0 +1,170 @@
+#include "distance_oracle.h"
+#include "graph_search.h"
+#include "metrics.h"
+#include "solver_workspace.h"
+#include "thread_pool.h"
+#include "visibility_graph.h"
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+namespace marine_nav
+{
+    static_assert(sizeof(OracleHeader) == 40, "OracleHeader layout must not change within a version");
+
+    namespace
+    {
+        const char kOracleMagic[8] = {'M', 'N', 'O', 'R', 'A', 'C', 'L', 'E'};
+
+        bool host_is_little_endian()
+        {
+            const uint16_t probe = 1;
+            unsigned char first;
+            std::memcpy(&first, &probe, 1);
+            return first == 1;
+        }
+    }
+
+    DistanceOracle::DistanceOracle()
+        : distances_(nullptr), node_count_(0), segment_count_(0), fingerprint_(0) {}
+
+    uint64_t DistanceOracle::fingerprint(const std::vector<Segment>& segments)
+    {
+        // FNV-1a over the raw bytes of every coordinate and order.
+        uint64_t hash = 1469598103934665603ull;
+        auto mix = [&hash](const void* data, size_t size)
+        {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; ++i)
+            {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+        };
+        for (const auto& segment : segments)
+        {
+            double coordinates[4] = {segment.left.x, segment.left.y, segment.right.x, segment.right.y};
+            int32_t order = segment.order;
+            mix(coordinates, sizeof(coordinates));
+            mix(&order, sizeof(order));
+        }
+        return hash;
+    }
+
+    void DistanceOracle::clear()
+    {
+        file_.reset();
+        owned_.clear();
+        owned_.shrink_to_fit();
+        distances_ = nullptr;
+        node_count_ = 0;
+        segment_count_ = 0;
+        fingerprint_ = 0;
+    }
+
+    void DistanceOracle::build(const VisibilityGraph& graph, const std::vector<Segment>& segments, size_t thread_count)
+    {
+        MARINE_NAV_PHASE("build_oracle");
+        if (graph.is_lazy() || graph.get_node_count() != 2 * segments.size())
+        {
+            throw std::runtime_error("Distance oracle needs a gateway graph over the same segments");
+        }
+        clear();
+        const double infinity = std::numeric_limits<double>::infinity();
+        node_count_ = graph.get_node_count();
+        segment_count_ = segments.size();
+        fingerprint_ = fingerprint(segments);
+        owned_.assign(get_entry_count(), infinity);
+        ThreadPool pool(thread_count);
+        std::vector<std::unique_ptr<SolverWorkspace>> workspaces;
+        for (size_t i = 0; i < pool.size(); ++i)
+        {
+            workspaces.push_back(std::make_unique<SolverWorkspace>());
+        }
+        // Rows near the top of the triangle are the longest, so sources go out one at a time.
+        pool.parallel_for(node_count_, 1, [&](size_t begin, size_t end, size_t worker)
+        {
+            SolverWorkspace& workspace = *workspaces[worker];
+            for (size_t source = begin; source < end; ++source)
+            {
+                search_from(workspace, node_count_, static_cast<int>(source), -1, [&](int u, const auto& relax)
+                {
+                    NeighborRange row = forward_part(graph.get_row(u), u);
+                    for (size_t k = 0; k < row.count; ++k)
+                    {
+                        relax(row.targets[k], row.weights[k]);
+                    }
+                });
+                double* out = owned_.data() + row_offset(source);
+                for (size_t v = source; v < node_count_; ++v)
+                {
+                    out[v - source] = workspace.distance(static_cast<int>(v));
+                }
+            }
+        });
+        distances_ = owned_.data();
+    }
+
+    void DistanceOracle::write(const std::string& filename) const
+    {
+        if (!is_ready())
+        {
+            throw std::runtime_error("Distance oracle has not been built");
+        }
+        if (!host_is_little_endian())
+        {
+            throw std::runtime_error("Oracle files can only be written on little-endian hosts");
+        }
+        OracleHeader header = {};
+        std::memcpy(header.magic, kOracleMagic, sizeof(kOracleMagic));
+        header.version = kVersion;
+        header.node_count = node_count_;
+        header.segment_count = segment_count_;
+        header.fingerprint = fingerprint_;
+        std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Could not create oracle file: " + filename);
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(distances_), static_cast<std::streamsize>(get_entry_count() * sizeof(double)));
+        if (!file)
+        {
+            throw std::runtime_error("Could not write oracle file: " + filename);
+        }
+    }
+
+    void DistanceOracle::load(const std::string& filename, const std::vector<Segment>& segments)
+    {
+        if (!host_is_little_endian())
+        {
+            throw std::runtime_error("Oracle files can only be read on little-endian hosts");
+        }
+        std::unique_ptr<MappedFile> file = std::make_unique<MappedFile>(filename);
+        if (file->size() < sizeof(OracleHeader) || std::memcmp(file->data(), kOracleMagic, sizeof(kOracleMagic)) != 0)
+        {
+            throw std::runtime_error("Not an oracle file: " + filename);
+        }
+        OracleHeader header;
+        std::memcpy(&header, file->data(), sizeof(header));
+        if (header.version != kVersion)
+        {
+            throw std::runtime_error("Unsupported oracle version " + std::to_string(header.version) + " in " + filename);
+        }
+        if (header.segment_count != segments.size() || header.node_count != 2 * header.segment_count
+            || header.fingerprint != fingerprint(segments))
+        {
+            throw std::runtime_error("Oracle file was built over different segments: " + filename);
+        }
+        size_t nodes = static_cast<size_t>(header.node_count);
+        if (file->size() != sizeof(OracleHeader) + nodes * (nodes + 1) / 2 * sizeof(double))
+        {
+            throw std::runtime_error("Oracle file is truncated or has inconsistent counts: " + filename);
+        }
+        clear();
+        file_ = std::move(file);
+        node_count_ = nodes;
+        segment_count_ = segments.size();
+        fingerprint_ = header.fingerprint;
+        distances_ = reinterpret_cast<const double*>(file_->data() + sizeof(OracleHeader));
+    }
+}
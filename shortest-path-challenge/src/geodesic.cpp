@@ -0,0 +1,312 @@
+#include "geodesic.h"
+#include "geometry.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MARINE_NAV_X86_SIMD 1
+#include <immintrin.h>
+#endif
+namespace marine_nav
+{
+    namespace
+    {
+        const double kPi = 3.14159265358979311600e+00;
+        const double kHalfPi = 1.57079632679489655800e+00;
+        const double kRadiansPerDegree = kPi / 180.0;
+        const double kDiameter = 2.0 * GeodesicKernel::kEarthRadius;
+
+        // fdlibm's rational approximation of (asin(x) - x) / x^3 in t = x^2, for |x| <= 0.5.
+        const double kPS0 = 1.66666666666666657415e-01;
+        const double kPS1 = -3.25565818622400915405e-01;
+        const double kPS2 = 2.01212532134862925881e-01;
+        const double kPS3 = -4.00555345006794114027e-02;
+        const double kPS4 = 7.91534994289814532176e-04;
+        const double kPS5 = 3.47933107596021167570e-05;
+        const double kQS1 = -2.40339491173441421878e+00;
+        const double kQS2 = 2.02094576023350569471e+00;
+        const double kQS3 = -6.88283971605453293030e-01;
+        const double kQS4 = 7.70381505559019352791e-02;
+
+        // Into [-180, 180).
+        double wrap_longitude(double lon)
+        {
+            return lon - 360.0 * std::floor((lon + 180.0) / 360.0);
+        }
+
+        void unit_vector(const Point& geographic, double& x, double& y, double& z)
+        {
+            double lon = geographic.x * kRadiansPerDegree;
+            double lat = geographic.y * kRadiansPerDegree;
+            x = std::cos(lat) * std::cos(lon);
+            y = std::cos(lat) * std::sin(lon);
+            z = std::sin(lat);
+        }
+
+        inline double arcsine_ratio(double t)
+        {
+            double p = t * (kPS0 + t * (kPS1 + t * (kPS2 + t * (kPS3 + t * (kPS4 + t * kPS5)))));
+            double q = 1.0 + t * (kQS1 + t * (kQS2 + t * (kQS3 + t * kQS4)));
+            return p / q;
+        }
+
+        // asin(h) for h in [0, 1], as fdlibm reduces it: directly below 0.5, through
+        // asin(h) = pi/2 - 2 asin(sqrt((1 - h) / 2)) above. Written out so the SIMD kernels can repeat
+        // exactly the same operations lane by lane.
+        inline double arcsine(double h)
+        {
+            if (h < 0.5)
+            {
+                return h + h * arcsine_ratio(h * h);
+            }
+            double t = (1.0 - h) * 0.5;
+            double s = std::sqrt(t);
+            return kHalfPi - 2.0 * (s + s * arcsine_ratio(t));
+        }
+
+        // Great-circle metres between two unit vectors, from half their chord.
+        inline double arc_length(double dx, double dy, double dz)
+        {
+            double half_chord = std::min(std::sqrt(dx * dx + dy * dy + dz * dz) * 0.5, 1.0);
+            return kDiameter * arcsine(half_chord);
+        }
+    }
+
+    LocalProjection::LocalProjection(double origin_lon, double origin_lat)
+        : origin_lon_(wrap_longitude(origin_lon)), origin_lat_(origin_lat),
+          metres_per_degree_x_(GeodesicKernel::kEarthRadius * kRadiansPerDegree * std::cos(origin_lat * kRadiansPerDegree)),
+          metres_per_degree_y_(GeodesicKernel::kEarthRadius * kRadiansPerDegree)
+    {
+        if (!(std::fabs(origin_lat) < 89.0))
+        {
+            throw std::invalid_argument("A local projection needs an origin latitude within 89 degrees of the equator");
+        }
+    }
+
+    LocalProjection LocalProjection::around(const std::vector<Point>& points)
+    {
+        if (points.empty())
+        {
+            return LocalProjection(0.0, 0.0);
+        }
+        // Longitudes are measured from the first point, so a box across the antimeridian stays narrow.
+        double reference = points.front().x;
+        double min_lon = 0.0, max_lon = 0.0;
+        double min_lat = points.front().y, max_lat = points.front().y;
+        for (const auto& point : points)
+        {
+            if (!(point.x >= -180.0 && point.x <= 180.0 && point.y >= -90.0 && point.y <= 90.0))
+            {
+                throw std::invalid_argument("Point " + point.label() + " is not a longitude/latitude in degrees");
+            }
+            double lon = wrap_longitude(point.x - reference);
+            min_lon = std::min(min_lon, lon);
+            max_lon = std::max(max_lon, lon);
+            min_lat = std::min(min_lat, point.y);
+            max_lat = std::max(max_lat, point.y);
+        }
+        return LocalProjection(reference + (min_lon + max_lon) * 0.5, (min_lat + max_lat) * 0.5);
+    }
+
+    Point LocalProjection::project(const Point& geographic) const
+    {
+        return Point(geographic.label_id, wrap_longitude(geographic.x - origin_lon_) * metres_per_degree_x_,
+                     (geographic.y - origin_lat_) * metres_per_degree_y_);
+    }
+
+    Point LocalProjection::unproject(const Point& planar) const
+    {
+        return Point(planar.label_id, wrap_longitude(origin_lon_ + planar.x / metres_per_degree_x_),
+                     origin_lat_ + planar.y / metres_per_degree_y_);
+    }
+
+    void GeodesicNodes::assign(const std::vector<Point>& geographic)
+    {
+        x.resize(geographic.size());
+        y.resize(geographic.size());
+        z.resize(geographic.size());
+        for (size_t i = 0; i < geographic.size(); ++i)
+        {
+            unit_vector(geographic[i], x[i], y[i], z[i]);
+        }
+    }
+
+    void GeodesicNodes::clear()
+    {
+        x.clear();
+        y.clear();
+        z.clear();
+    }
+
+    double GeodesicKernel::distance(const Point& a, const Point& b)
+    {
+        double ax, ay, az, bx, by, bz;
+        unit_vector(a, ax, ay, az);
+        unit_vector(b, bx, by, bz);
+        return arc_length(ax - bx, ay - by, az - bz);
+    }
+
+    void GeodesicKernel::row_distances(const GeodesicNodes& nodes, int from, const int* targets, size_t count, double* out, SimdLevel level)
+    {
+        MARINE_NAV_COUNT_N(GeodesicWeights, count);
+        switch (level)
+        {
+            case SimdLevel::AVX2:
+                row_distances_avx2(nodes, from, targets, count, out);
+                break;
+            case SimdLevel::SSE2:
+                row_distances_sse2(nodes, from, targets, count, out);
+                break;
+            default:
+                row_distances_scalar(nodes, from, targets, count, out);
+                break;
+        }
+    }
+
+    void GeodesicKernel::row_distances_scalar(const GeodesicNodes& nodes, int from, const int* targets, size_t count, double* out)
+    {
+        double fx = nodes.x[from];
+        double fy = nodes.y[from];
+        double fz = nodes.z[from];
+        for (size_t k = 0; k < count; ++k)
+        {
+            int to = targets[k];
+            out[k] = arc_length(fx - nodes.x[to], fy - nodes.y[to], fz - nodes.z[to]);
+        }
+    }
+
+#ifdef MARINE_NAV_X86_SIMD
+    namespace
+    {
+        __attribute__((target("sse2")))
+        inline __m128d arcsine_ratio_sse2(__m128d t)
+        {
+            __m128d p = _mm_add_pd(_mm_set1_pd(kPS4), _mm_mul_pd(t, _mm_set1_pd(kPS5)));
+            p = _mm_add_pd(_mm_set1_pd(kPS3), _mm_mul_pd(t, p));
+            p = _mm_add_pd(_mm_set1_pd(kPS2), _mm_mul_pd(t, p));
+            p = _mm_add_pd(_mm_set1_pd(kPS1), _mm_mul_pd(t, p));
+            p = _mm_add_pd(_mm_set1_pd(kPS0), _mm_mul_pd(t, p));
+            p = _mm_mul_pd(t, p);
+            __m128d q = _mm_add_pd(_mm_set1_pd(kQS3), _mm_mul_pd(t, _mm_set1_pd(kQS4)));
+            q = _mm_add_pd(_mm_set1_pd(kQS2), _mm_mul_pd(t, q));
+            q = _mm_add_pd(_mm_set1_pd(kQS1), _mm_mul_pd(t, q));
+            q = _mm_add_pd(_mm_set1_pd(1.0), _mm_mul_pd(t, q));
+            return _mm_div_pd(p, q);
+        }
+
+        // arc_length for two lanes. Both arcsine branches are x + x * arcsine_ratio(u), with x and u picked
+        // per lane, so the division is paid once and the square root only when a lane is 60 degrees or more.
+        __attribute__((target("sse2")))
+        inline __m128d arc_length_sse2(__m128d dx, __m128d dy, __m128d dz)
+        {
+            const __m128d half = _mm_set1_pd(0.5);
+            __m128d norm = _mm_add_pd(_mm_add_pd(_mm_mul_pd(dx, dx), _mm_mul_pd(dy, dy)), _mm_mul_pd(dz, dz));
+            __m128d h = _mm_min_pd(_mm_mul_pd(_mm_sqrt_pd(norm), half), _mm_set1_pd(1.0));
+            __m128d t = _mm_mul_pd(_mm_sub_pd(_mm_set1_pd(1.0), h), half);
+            __m128d near = _mm_cmplt_pd(h, half);
+            __m128d x = h;
+            __m128d u = _mm_mul_pd(h, h);
+            if (_mm_movemask_pd(near) != 0x3)
+            {
+                x = _mm_or_pd(_mm_and_pd(near, h), _mm_andnot_pd(near, _mm_sqrt_pd(t)));
+                u = _mm_or_pd(_mm_and_pd(near, u), _mm_andnot_pd(near, t));
+            }
+            __m128d a = _mm_add_pd(x, _mm_mul_pd(x, arcsine_ratio_sse2(u)));
+            __m128d far = _mm_sub_pd(_mm_set1_pd(kHalfPi), _mm_mul_pd(_mm_set1_pd(2.0), a));
+            __m128d angle = _mm_or_pd(_mm_and_pd(near, a), _mm_andnot_pd(near, far));
+            return _mm_mul_pd(_mm_set1_pd(kDiameter), angle);
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256d arcsine_ratio_avx2(__m256d t)
+        {
+            __m256d p = _mm256_add_pd(_mm256_set1_pd(kPS4), _mm256_mul_pd(t, _mm256_set1_pd(kPS5)));
+            p = _mm256_add_pd(_mm256_set1_pd(kPS3), _mm256_mul_pd(t, p));
+            p = _mm256_add_pd(_mm256_set1_pd(kPS2), _mm256_mul_pd(t, p));
+            p = _mm256_add_pd(_mm256_set1_pd(kPS1), _mm256_mul_pd(t, p));
+            p = _mm256_add_pd(_mm256_set1_pd(kPS0), _mm256_mul_pd(t, p));
+            p = _mm256_mul_pd(t, p);
+            __m256d q = _mm256_add_pd(_mm256_set1_pd(kQS3), _mm256_mul_pd(t, _mm256_set1_pd(kQS4)));
+            q = _mm256_add_pd(_mm256_set1_pd(kQS2), _mm256_mul_pd(t, q));
+            q = _mm256_add_pd(_mm256_set1_pd(kQS1), _mm256_mul_pd(t, q));
+            q = _mm256_add_pd(_mm256_set1_pd(1.0), _mm256_mul_pd(t, q));
+            return _mm256_div_pd(p, q);
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256d arc_length_avx2(__m256d dx, __m256d dy, __m256d dz)
+        {
+            const __m256d half = _mm256_set1_pd(0.5);
+            __m256d norm = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy)), _mm256_mul_pd(dz, dz));
+            __m256d h = _mm256_min_pd(_mm256_mul_pd(_mm256_sqrt_pd(norm), half), _mm256_set1_pd(1.0));
+            __m256d t = _mm256_mul_pd(_mm256_sub_pd(_mm256_set1_pd(1.0), h), half);
+            __m256d near = _mm256_cmp_pd(h, half, _CMP_LT_OQ);
+            __m256d x = h;
+            __m256d u = _mm256_mul_pd(h, h);
+            if (_mm256_movemask_pd(near) != 0xF)
+            {
+                // A leg of 60 degrees of arc or more: those lanes take the reduced argument.
+                x = _mm256_blendv_pd(_mm256_sqrt_pd(t), h, near);
+                u = _mm256_blendv_pd(t, u, near);
+            }
+            __m256d a = _mm256_add_pd(x, _mm256_mul_pd(x, arcsine_ratio_avx2(u)));
+            __m256d far = _mm256_sub_pd(_mm256_set1_pd(kHalfPi), _mm256_mul_pd(_mm256_set1_pd(2.0), a));
+            return _mm256_mul_pd(_mm256_set1_pd(kDiameter), _mm256_blendv_pd(far, a, near));
+        }
+    }
+
+    __attribute__((target("sse2")))
+    void GeodesicKernel::row_distances_sse2(const GeodesicNodes& nodes, int from, const int* targets, size_t count, double* out)
+    {
+        const __m128d fx = _mm_set1_pd(nodes.x[from]);
+        const __m128d fy = _mm_set1_pd(nodes.y[from]);
+        const __m128d fz = _mm_set1_pd(nodes.z[from]);
+        size_t k = 0;
+        for (; k + 2 <= count; k += 2)
+        {
+            int a = targets[k];
+            int b = targets[k + 1];
+            __m128d dx = _mm_sub_pd(fx, _mm_set_pd(nodes.x[b], nodes.x[a]));
+            __m128d dy = _mm_sub_pd(fy, _mm_set_pd(nodes.y[b], nodes.y[a]));
+            __m128d dz = _mm_sub_pd(fz, _mm_set_pd(nodes.z[b], nodes.z[a]));
+            _mm_storeu_pd(out + k, arc_length_sse2(dx, dy, dz));
+        }
+        row_distances_scalar(nodes, from, targets + k, count - k, out + k);
+    }
+
+    __attribute__((target("avx2")))
+    void GeodesicKernel::row_distances_avx2(const GeodesicNodes& nodes, int from, const int* targets, size_t count, double* out)
+    {
+        const __m256d fx = _mm256_set1_pd(nodes.x[from]);
+        const __m256d fy = _mm256_set1_pd(nodes.y[from]);
+        const __m256d fz = _mm256_set1_pd(nodes.z[from]);
+        size_t k = 0;
+        // Lanes are loaded one by one: microcode mitigations make vgatherdpd slower than four scalar loads
+        // on many Intel parts.
+        for (; k + 4 <= count; k += 4)
+        {
+            int a = targets[k];
+            int b = targets[k + 1];
+            int c = targets[k + 2];
+            int d = targets[k + 3];
+            __m256d dx = _mm256_sub_pd(fx, _mm256_set_pd(nodes.x[d], nodes.x[c], nodes.x[b], nodes.x[a]));
+            __m256d dy = _mm256_sub_pd(fy, _mm256_set_pd(nodes.y[d], nodes.y[c], nodes.y[b], nodes.y[a]));
+            __m256d dz = _mm256_sub_pd(fz, _mm256_set_pd(nodes.z[d], nodes.z[c], nodes.z[b], nodes.z[a]));
+            _mm256_storeu_pd(out + k, arc_length_avx2(dx, dy, dz));
+        }
+        _mm256_zeroupper();
+        row_distances_scalar(nodes, from, targets + k, count - k, out + k);
+    }
+#else
+    void GeodesicKernel::row_distances_sse2(const GeodesicNodes& nodes, int from, const int* targets, size_t count, double* out)
+    {
+        row_distances_scalar(nodes, from, targets, count, out);
+    }
+
+    void GeodesicKernel::row_distances_avx2(const GeodesicNodes& nodes, int from, const int* targets, size_t count, double* out)
+    {
+        row_distances_scalar(nodes, from, targets, count, out);
+    }
+#endif
+}
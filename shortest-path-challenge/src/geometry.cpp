@@ -1,6 +1,10 @@
 #include "geometry.h"
+#include "metrics.h"
 #include <cmath>
+#include <algorithm>
 #include <iostream>
+#include <climits>
+#include <stdexcept>
 namespace marine_nav 
 {
     double Point::distance_to(const Point& other) const 
@@ -12,80 +16,207 @@ namespace marine_nav
 
     bool Segment::is_point_on_correct_side(const Point& point, bool should_be_left) const 
     {
-        double cross = (right.x - left.x) * (point.y - left.y) - (right.y - left.y) * (point.x - left.x);
-        bool is_on_left = cross > 0;
+        bool is_on_left = IntersectionKernel::orientation(left.x, left.y, right.x, right.y, point.x, point.y) > 0;
         return should_be_left ? is_on_left : !is_on_left;
     }
 
+    double Segment::distance_to(const Point& point) const 
+    {
+        double dx = right.x - left.x;
+        double dy = right.y - left.y;
+        double length_sq = dx * dx + dy * dy;
+        double t = length_sq > 0.0 ? ((point.x - left.x) * dx + (point.y - left.y) * dy) / length_sq : 0.0;
+        t = std::max(0.0, std::min(1.0, t));
+        double px = left.x + t * dx - point.x;
+        double py = left.y + t * dy - point.y;
+        return std::sqrt(px * px + py * py);
+    }
+
+    double Segment::distance_to(const Segment& other) const 
+    {
+        if (IntersectionKernel::segments_intersect(left.x, left.y, right.x, right.y, other.left.x, other.left.y, other.right.x, other.right.y)) 
+        {
+            return 0.0;
+        }
+        return std::min(std::min(distance_to(other.left), distance_to(other.right)), 
+                        std::min(other.distance_to(left), other.distance_to(right)));
+    }
+
     Point Segment::get_optimal_crossing_point(const Point& from, const Point& to) const 
     {
-        double mid_x = (left.x + right.x) / 2.0;
-        double mid_y = (left.y + right.y) / 2.0;
-        return Point("crossing_" + std::to_string(order), mid_x, mid_y);
+        // Minimizes |from, p| + |p, to| over p on the segment. If to lies on the same side as from it is
+        // mirrored across the supporting line first; the optimum is then where from-to meets that line,
+        // clamped to the segment because the cost is convex along it.
+        double dx = right.x - left.x;
+        double dy = right.y - left.y;
+        double length_sq = dx * dx + dy * dy;
+        double t = 0.0;
+        if (length_sq > 0.0) 
+        {
+            double cross_from = dx * (from.y - left.y) - dy * (from.x - left.x);
+            double cross_to = dx * (to.y - left.y) - dy * (to.x - left.x);
+            double target_x = to.x;
+            double target_y = to.y;
+            if ((cross_from > 0 && cross_to > 0) || (cross_from < 0 && cross_to < 0)) 
+            {
+                double scale = 2.0 * cross_to / length_sq;
+                target_x += scale * dy;
+                target_y -= scale * dx;
+                cross_to = -cross_to;
+            }
+            double denom = cross_from - cross_to;
+            double qx = from.x;
+            double qy = from.y;
+            if (denom != 0.0) 
+            {
+                double u = cross_from / denom;
+                qx = from.x + u * (target_x - from.x);
+                qy = from.y + u * (target_y - from.y);
+            }
+            t = ((qx - left.x) * dx + (qy - left.y) * dy) / length_sq;
+            t = std::max(0.0, std::min(1.0, t));
+        }
+        if (t == 0.0) 
+        {
+            return left;
+        }
+        if (t == 1.0) 
+        {
+            return right;
+        }
+        return Point(crossing_label_id(), left.x + t * dx, left.y + t * dy);
     }
 
     GeometryEngine::GeometryEngine() 
+        : backend_(IntersectionBackend::Native), simd_level_(IntersectionKernel::detect_simd_level()), prepared_source_(nullptr), 
+          use_spatial_index_(true) {}
+
+    void GeometryEngine::set_intersection_backend(IntersectionBackend backend)
     {
-        geos_context_ = GEOS_init_r();
-        if (!geos_context_) 
+        backend_ = backend;
+        if (backend_ != IntersectionBackend::Geos)
         {
-            throw std::runtime_error("Failed to initialize GEOS context");
+            geos_prepared_.clear();
+        }
+        else if (prepared_source_ && geos_prepared_.size() != prepared_source_->size())
+        {
+            geos_prepared_.build(*prepared_source_);
         }
     }
 
-    GeometryEngine::~GeometryEngine() 
+    void GeometryEngine::set_simd_level(SimdLevel level)
     {
-        if (geos_context_) 
+        SimdLevel supported = IntersectionKernel::detect_simd_level();
+        simd_level_ = static_cast<int>(level) > static_cast<int>(supported) ? supported : level;
+    }
+
+    void GeometryEngine::prepare_segments(const std::vector<Segment>& segments)
+    {
+        prepared_arrays_.assign(segments);
+        segment_index_.build(segments);
+        prepared_source_ = &segments;
+        if (backend_ == IntersectionBackend::Geos)
         {
-            GEOS_finish_r(geos_context_);
+            geos_prepared_.build(segments);
         }
     }
 
-    bool GeometryEngine::line_intersects_obstacles(const Point& from, const Point& to, const std::vector<Segment>& segments) const 
+    void GeometryEngine::clear_prepared_segments()
     {
-        GEOSCoordSequence* coord_seq = GEOSCoordSeq_create_r(geos_context_, 2, 2);
-        GEOSCoordSeq_setX_r(geos_context_, coord_seq, 0, from.x);
-        GEOSCoordSeq_setY_r(geos_context_, coord_seq, 0, from.y);
-        GEOSCoordSeq_setX_r(geos_context_, coord_seq, 1, to.x);
-        GEOSCoordSeq_setY_r(geos_context_, coord_seq, 1, to.y);
-        GEOSGeometry* line = GEOSGeom_createLineString_r(geos_context_, coord_seq);
+        prepared_arrays_.clear();
+        segment_index_.clear();
+        geos_prepared_.clear();
+        prepared_source_ = nullptr;
+    }
+
+    bool GeometryEngine::geos_intersects_any(const Point& from, const Point& to, const std::vector<Segment>& segments, int min_order) const
+    {
+        GEOSContextHandle_t context = GeosContext::local();
+        GEOSGeometry* line = GeosPreparedSegments::create_line(context, from.x, from.y, to.x, to.y);
         bool intersects = false;
+        if (prepared_source_ == &segments && geos_prepared_.size() == segments.size())
+        {
+            if (min_order == INT_MIN)
+            {
+                intersects = geos_prepared_.intersects_any(context, line);
+            }
+            else if (use_spatial_index_)
+            {
+                // Only segments whose envelope overlaps the line's can intersect it.
+                thread_local std::vector<int> candidates;
+                candidates.clear();
+                segment_index_.query(std::min(from.x, to.x), std::min(from.y, to.y), std::max(from.x, to.x), std::max(from.y, to.y), candidates);
+                for (int i : candidates)
+                {
+                    if (segments[i].order > min_order && geos_prepared_.intersects(context, i, line))
+                    {
+                        intersects = true;
+                        break;
+                    }
+                }
+            }
+            else
+            {
+                for (size_t i = 0; i < segments.size(); ++i)
+                {
+                    if (segments[i].order > min_order && geos_prepared_.intersects(context, i, line))
+                    {
+                        intersects = true;
+                        break;
+                    }
+                }
+            }
+            GEOSGeom_destroy_r(context, line);
+            return intersects;
+        }
         for (const auto& segment : segments) 
         {
-            GEOSCoordSequence* seg_coord_seq = GEOSCoordSeq_create_r(geos_context_, 2, 2);
-            GEOSCoordSeq_setX_r(geos_context_, seg_coord_seq, 0, segment.left.x);
-            GEOSCoordSeq_setY_r(geos_context_, seg_coord_seq, 0, segment.left.y);
-            GEOSCoordSeq_setX_r(geos_context_, seg_coord_seq, 1, segment.right.x);
-            GEOSCoordSeq_setY_r(geos_context_, seg_coord_seq, 1, segment.right.y);
-            GEOSGeometry* seg_line = GEOSGeom_createLineString_r(geos_context_, seg_coord_seq);
-            if (GEOSIntersects_r(geos_context_, line, seg_line)) 
+            if (segment.order <= min_order)
+            {
+                continue;
+            }
+            GEOSGeometry* seg_line = GeosPreparedSegments::create_line(context, segment.left.x, segment.left.y, segment.right.x, segment.right.y);
+            MARINE_NAV_COUNT(GeosIntersects);
+            if (GEOSIntersects_r(context, line, seg_line)) 
             {
                 intersects = true;
-                GEOSGeom_destroy_r(geos_context_, seg_line);
+                GEOSGeom_destroy_r(context, seg_line);
                 break;
             }
-            GEOSGeom_destroy_r(geos_context_, seg_line);
+            GEOSGeom_destroy_r(context, seg_line);
         }
-        GEOSGeom_destroy_r(geos_context_, line);
+        GEOSGeom_destroy_r(context, line);
         return intersects;
     }
+
+    bool GeometryEngine::line_intersects_obstacles(const Point& from, const Point& to, const std::vector<Segment>& segments) const 
+    {
+        if (backend_ == IntersectionBackend::Geos)
+        {
+            return geos_intersects_any(from, to, segments, INT_MIN);
+        }
+        if (prepared_source_ == &segments && segment_index_.size() == segments.size() && use_spatial_index_)
+        {
+            return segment_index_.any_intersection(from.x, from.y, to.x, to.y, INT_MIN, simd_level_);
+        }
+        for (const auto& segment : segments)
+        {
+            if (IntersectionKernel::segments_intersect(from.x, from.y, to.x, to.y, segment.left.x, segment.left.y, segment.right.x, segment.right.y))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
  
     bool GeometryEngine::path_maintains_constraints(const std::vector<Point>& path, const std::vector<Segment>& segments) const 
     {    
-        for (size_t i = 0; i < path.size() - 1; ++i) 
+        for (size_t i = 0; i + 1 < path.size(); ++i) 
         {
-            const Point& from = path[i];
-            const Point& to = path[i + 1];    
-            for (const auto& segment : segments) 
+            // No segment is later than INT_MAX, so only the orientation half of the fused check applies.
+            if (check_constraints(path[i], path[i + 1], segments, INT_MAX) != ConstraintFailure::None) 
             {
-                if (!segment.is_point_on_correct_side(segment.left, true)) 
-                {
-                    return false;
-                }
-                if (!segment.is_point_on_correct_side(segment.right, false)) 
-                {
-                    return false;
-                }
+                return false;
             }
         }
         return true;
@@ -96,23 +227,53 @@ namespace marine_nav
         return from.distance_to(to);
     }
 
+    ConstraintFailure GeometryEngine::check_constraints(const Point& from, const Point& to, const std::vector<Segment>& segments, int current_segment_order) const
+    {
+        if (prepared_source_ == &segments && prepared_arrays_.size() == segments.size())
+        {
+            return IntersectionKernel::first_violation(prepared_arrays_, 0, prepared_arrays_.size(), from.x, from.y, to.x, to.y, current_segment_order);
+        }
+        SegmentArrays arrays;
+        arrays.assign(segments);
+        return IntersectionKernel::first_violation(arrays, 0, arrays.size(), from.x, from.y, to.x, to.y, current_segment_order);
+    }
+
     bool GeometryEngine::is_visible(const Point& from, const Point& to, const std::vector<Segment>& segments, int current_segment_order) const 
     {
-        for (const auto& segment : segments) 
+        if (backend_ == IntersectionBackend::Geos)
         {
-            if (segment.order <= current_segment_order) 
+            if (geos_intersects_any(from, to, segments, current_segment_order))
             {
-                continue; 
+                return false;
             }
-            if (line_intersects_obstacles(from, to, {segment})) 
+        }
+        else if (prepared_source_ == &segments && prepared_arrays_.size() == segments.size() && use_spatial_index_)
+        {
+            if (segment_index_.any_intersection(from.x, from.y, to.x, to.y, current_segment_order, simd_level_))
+            {
+                return false;
+            }
+        }
+        else if (prepared_source_ == &segments && prepared_arrays_.size() == segments.size())
+        {
+            if (IntersectionKernel::any_intersection(prepared_arrays_, 0, prepared_arrays_.size(), from.x, from.y, to.x, to.y, current_segment_order, simd_level_))
+            {
+                return false;
+            }
+        }
+        else
+        {
+            SegmentArrays arrays;
+            arrays.assign(segments);
+            if (IntersectionKernel::any_intersection(arrays, 0, arrays.size(), from.x, from.y, to.x, to.y, current_segment_order, simd_level_))
             {
                 return false;
             }
         }
         for (const auto& segment : segments) 
         {
-            double cross_left = (to.x - from.x) * (segment.left.y - from.y) - (to.y - from.y) * (segment.left.x - from.x);
-            double cross_right = (to.x - from.x) * (segment.right.y - from.y) - (to.y - from.y) * (segment.right.x - from.x);
+            double cross_left = IntersectionKernel::orientation(from.x, from.y, to.x, to.y, segment.left.x, segment.left.y);
+            double cross_right = IntersectionKernel::orientation(from.x, from.y, to.x, to.y, segment.right.x, segment.right.y);
             if (cross_left <= 0 || cross_right >= 0) 
             {
                 return false;
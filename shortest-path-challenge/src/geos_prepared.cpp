@@ -0,0 +1,109 @@
+#include "geos_prepared.h"
+#include "geometry.h"
+#include "metrics.h"
+#include <stdexcept>
+namespace marine_nav
+{
+    namespace
+    {
+        struct ThreadContext
+        {
+            GEOSContextHandle_t handle;
+            ThreadContext() : handle(GEOS_init_r())
+            {
+                if (!handle)
+                {
+                    throw std::runtime_error("Failed to initialize GEOS context");
+                }
+            }
+            ~ThreadContext()
+            {
+                GEOS_finish_r(handle);
+            }
+        };
+    }
+
+    GEOSContextHandle_t GeosContext::local()
+    {
+        thread_local ThreadContext context;
+        return context.handle;
+    }
+
+    GeosPreparedSegments::GeosPreparedSegments() : collection_(nullptr), prepared_collection_(nullptr) {}
+
+    GeosPreparedSegments::~GeosPreparedSegments()
+    {
+        clear();
+    }
+
+    GEOSGeometry* GeosPreparedSegments::create_line(GEOSContextHandle_t context, double from_x, double from_y, double to_x, double to_y)
+    {
+        GEOSCoordSequence* coord_seq = GEOSCoordSeq_create_r(context, 2, 2);
+        GEOSCoordSeq_setX_r(context, coord_seq, 0, from_x);
+        GEOSCoordSeq_setY_r(context, coord_seq, 0, from_y);
+        GEOSCoordSeq_setX_r(context, coord_seq, 1, to_x);
+        GEOSCoordSeq_setY_r(context, coord_seq, 1, to_y);
+        return GEOSGeom_createLineString_r(context, coord_seq);
+    }
+
+    void GeosPreparedSegments::build(const std::vector<Segment>& segments)
+    {
+        clear();
+        if (segments.empty())
+        {
+            return;
+        }
+        GEOSContextHandle_t context = GeosContext::local();
+        std::vector<GEOSGeometry*> lines;
+        lines.reserve(segments.size());
+        for (const auto& segment : segments)
+        {
+            lines.push_back(create_line(context, segment.left.x, segment.left.y, segment.right.x, segment.right.y));
+        }
+        prepared_lines_.reserve(lines.size());
+        for (GEOSGeometry* line : lines)
+        {
+            const GEOSPreparedGeometry* prepared = GEOSPrepare_r(context, line);
+            GEOSPreparedIntersects_r(context, prepared, line);
+            prepared_lines_.push_back(prepared);
+        }
+        // The collection takes ownership of the lines; the prepared lines keep pointing into it.
+        collection_ = GEOSGeom_createCollection_r(context, GEOS_MULTILINESTRING, lines.data(), static_cast<unsigned>(lines.size()));
+        prepared_collection_ = GEOSPrepare_r(context, collection_);
+        GEOSPreparedIntersects_r(context, prepared_collection_, lines.front());
+    }
+
+    void GeosPreparedSegments::clear()
+    {
+        if (!collection_)
+        {
+            return;
+        }
+        GEOSContextHandle_t context = GeosContext::local();
+        for (const GEOSPreparedGeometry* prepared : prepared_lines_)
+        {
+            GEOSPreparedGeom_destroy_r(context, prepared);
+        }
+        prepared_lines_.clear();
+        GEOSPreparedGeom_destroy_r(context, prepared_collection_);
+        prepared_collection_ = nullptr;
+        GEOSGeom_destroy_r(context, collection_);
+        collection_ = nullptr;
+    }
+
+    bool GeosPreparedSegments::intersects_any(GEOSContextHandle_t context, const GEOSGeometry* line) const
+    {
+        if (!prepared_collection_)
+        {
+            return false;
+        }
+        MARINE_NAV_COUNT(GeosIntersects);
+        return GEOSPreparedIntersects_r(context, prepared_collection_, line) == 1;
+    }
+
+    bool GeosPreparedSegments::intersects(GEOSContextHandle_t context, size_t i, const GEOSGeometry* line) const
+    {
+        MARINE_NAV_COUNT(GeosIntersects);
+        return GEOSPreparedIntersects_r(context, prepared_lines_[i], line) == 1;
+    }
+}
@@ -0,0 +1,371 @@
+#include "incremental_graph.h"
+#include <algorithm>
+#include <climits>
+#include <stdexcept>
+#include <utility>
+namespace marine_nav
+{
+    IncrementalVisibilityGraph::IncrementalVisibilityGraph() : edge_count_(0), pairs_evaluated_(0), segment_checks_(0) {}
+
+    void IncrementalVisibilityGraph::build(const std::vector<Segment>& segments, const Point& start, const Point& end)
+    {
+        segments_.clear();
+        segment_alive_.clear();
+        nodes_.clear();
+        rows_.clear();
+        witness_.clear();
+        witnessed_pairs_.clear();
+        edge_index_.clear();
+        indexed_edges_.clear();
+        unindexed_edges_.clear();
+        changed_.clear();
+        changed_nodes_.clear();
+        edge_count_ = 0;
+        pairs_evaluated_ = 0;
+        segment_checks_ = 0;
+        nodes_.emplace_back(start, -1, false);
+        nodes_.emplace_back(end, INT_MAX, false);
+        rows_.resize(2);
+        changed_.assign(2, 0);
+        for (const auto& segment : segments)
+        {
+            segments_.push_back(segment);
+            segment_alive_.push_back(1);
+            witnessed_pairs_.emplace_back();
+            add_nodes(segment);
+        }
+        for (int v = 1; v < static_cast<int>(nodes_.size()); ++v)
+        {
+            for (int u = 0; u < v; ++u)
+            {
+                apply(u, v, evaluate(u, v));
+            }
+        }
+        rebuild_edge_index();
+    }
+
+    void IncrementalVisibilityGraph::add_nodes(const Segment& segment)
+    {
+        nodes_.emplace_back(segment.left, segment.order, true);
+        nodes_.emplace_back(segment.right, segment.order, false);
+        rows_.resize(nodes_.size());
+        changed_.resize(nodes_.size(), 0);
+    }
+
+    bool IncrementalVisibilityGraph::is_node_alive(int node) const
+    {
+        return node < 2 || segment_alive_[(node - 2) / 2];
+    }
+
+    bool IncrementalVisibilityGraph::precedes(int u, int v) const
+    {
+        auto rank = [](int node)
+        {
+            return node == 1 ? INT_MAX : (node == 0 ? 0 : node - 1);
+        };
+        return rank(u) < rank(v);
+    }
+
+    int32_t IncrementalVisibilityGraph::evaluate(int u, int v)
+    {
+        ++pairs_evaluated_;
+        if (!is_node_alive(u) || !is_node_alive(v))
+        {
+            return kDead;
+        }
+        if (!precedes(u, v))
+        {
+            std::swap(u, v);
+        }
+        const GraphNode& from = nodes_[u];
+        const GraphNode& to = nodes_[v];
+        if (!VisibilityGraph::ordering_allows(from, to))
+        {
+            return kOrdering;
+        }
+        // The endpoints' own segments first, so that the common case needs no witness record.
+        int own[2] = {u >= 2 ? (u - 2) / 2 : -1, v >= 2 ? (v - 2) / 2 : -1};
+        for (int slot : own)
+        {
+            if (slot >= 0)
+            {
+                ++segment_checks_;
+                if (VisibilityGraph::segment_blocks(from, to, segments_[slot]))
+                {
+                    return kOwnSegment;
+                }
+            }
+        }
+        for (size_t slot = 0; slot < segments_.size(); ++slot)
+        {
+            if (!segment_alive_[slot] || static_cast<int>(slot) == own[0] || static_cast<int>(slot) == own[1])
+            {
+                continue;
+            }
+            ++segment_checks_;
+            if (VisibilityGraph::segment_blocks(from, to, segments_[slot]))
+            {
+                return static_cast<int32_t>(slot);
+            }
+        }
+        return kEdge;
+    }
+
+    void IncrementalVisibilityGraph::apply(int u, int v, int32_t witness)
+    {
+        if (u > v)
+        {
+            std::swap(u, v);
+        }
+        uint64_t key = pair_key(u, v);
+        int32_t current = witness_of(key);
+        if (current == kEdge && witness != kEdge)
+        {
+            remove_edge(u, v);
+        }
+        else if (current != kEdge && witness == kEdge)
+        {
+            add_edge(u, v);
+        }
+        if (witness >= 0 && witness != current)
+        {
+            witnessed_pairs_[witness].push_back(key);
+        }
+        if (witness == kEdge || witness >= 0)
+        {
+            witness_[key] = witness;
+        }
+        else if (current == kEdge || current >= 0)
+        {
+            witness_.erase(key);
+        }
+    }
+
+    void IncrementalVisibilityGraph::add_edge(int u, int v)
+    {
+        double weight = nodes_[u].point.distance_to(nodes_[v].point);
+        rows_[u].push_back(Neighbor{v, weight});
+        rows_[v].push_back(Neighbor{u, weight});
+        unindexed_edges_.push_back(pair_key(u, v));
+        ++edge_count_;
+        mark_changed(u);
+        mark_changed(v);
+    }
+
+    void IncrementalVisibilityGraph::remove_edge(int u, int v)
+    {
+        auto erase = [](std::vector<Neighbor>& row, int target)
+        {
+            for (size_t k = 0; k < row.size(); ++k)
+            {
+                if (row[k].target == target)
+                {
+                    row[k] = row.back();
+                    row.pop_back();
+                    return;
+                }
+            }
+        };
+        erase(rows_[u], v);
+        erase(rows_[v], u);
+        indexed_edges_.erase(pair_key(u, v));
+        --edge_count_;
+        mark_changed(u);
+        mark_changed(v);
+    }
+
+    void IncrementalVisibilityGraph::mark_changed(int node)
+    {
+        if (!changed_[node])
+        {
+            changed_[node] = 1;
+            changed_nodes_.push_back(node);
+        }
+    }
+
+    void IncrementalVisibilityGraph::reevaluate_node_pairs(int node)
+    {
+        // Existing edges of a moved endpoint carry stale weights, so drop them before re-testing.
+        std::vector<Neighbor> row = rows_[node];
+        for (const auto& neighbor : row)
+        {
+            apply(node, neighbor.target, kDead);
+        }
+        for (int other = 0; other < static_cast<int>(nodes_.size()); ++other)
+        {
+            if (other != node)
+            {
+                apply(node, other, evaluate(node, other));
+            }
+        }
+    }
+
+    void IncrementalVisibilityGraph::reevaluate_witnessed(int slot)
+    {
+        std::vector<uint64_t> pairs;
+        pairs.swap(witnessed_pairs_[slot]);
+        for (uint64_t packed : pairs)
+        {
+            int u = static_cast<int>(packed >> 32);
+            int v = static_cast<int>(packed & 0xffffffffu);
+            auto it = witness_.find(packed);
+            if (it == witness_.end() || it->second != slot)
+            {
+                continue;   // stale entry: the pair has been re-witnessed since
+            }
+            // Forget the old witness first so a pair that slot still blocks is listed again.
+            witness_.erase(it);
+            apply(u, v, evaluate(u, v));
+        }
+    }
+
+    void IncrementalVisibilityGraph::rebuild_edge_index()
+    {
+        std::vector<EdgeIndex::Edge> edges;
+        edges.reserve(edge_count_);
+        indexed_edges_.clear();
+        for (int u = 0; u < static_cast<int>(nodes_.size()); ++u)
+        {
+            for (const auto& neighbor : rows_[u])
+            {
+                int v = neighbor.target;
+                if (v < u)
+                {
+                    continue;
+                }
+                bool u_first = precedes(u, v);
+                const Point& from = nodes_[u_first ? u : v].point;
+                const Point& to = nodes_[u_first ? v : u].point;
+                edges.push_back(EdgeIndex::Edge{pair_key(u, v), from.x, from.y, to.x, to.y});
+                indexed_edges_.insert(pair_key(u, v));
+            }
+        }
+        edge_index_.build(edges);
+        unindexed_edges_.clear();
+    }
+
+    void IncrementalVisibilityGraph::block_edges_with(int slot)
+    {
+        // Edges added since the index was packed, and removed ones it still holds, are both paid for
+        // on every insert, so the index is repacked once they outnumber half of it.
+        size_t stale = edge_index_.size() - indexed_edges_.size();
+        if (unindexed_edges_.size() + stale > edge_index_.size() / 2 + 64)
+        {
+            rebuild_edge_index();
+        }
+        const Segment& segment = segments_[slot];
+        std::vector<uint64_t> candidates;
+        edge_index_.query(segment, candidates);
+        candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [this](uint64_t key)
+        {
+            return indexed_edges_.count(key) == 0;
+        }), candidates.end());
+        for (uint64_t key : unindexed_edges_)
+        {
+            if (witness_of(key) == kEdge)
+            {
+                candidates.push_back(key);
+            }
+        }
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+        std::vector<std::pair<int, int>> blocked;
+        for (uint64_t key : candidates)
+        {
+            int u = static_cast<int>(key >> 32);
+            int v = static_cast<int>(key & 0xffffffffu);
+            ++segment_checks_;
+            bool u_first = precedes(u, v);
+            if (VisibilityGraph::segment_blocks(nodes_[u_first ? u : v], nodes_[u_first ? v : u], segment))
+            {
+                blocked.emplace_back(u, v);
+            }
+        }
+        for (const auto& pair : blocked)
+        {
+            apply(pair.first, pair.second, slot);
+        }
+    }
+
+    int IncrementalVisibilityGraph::insert_segment(const Segment& segment)
+    {
+        int slot = static_cast<int>(segments_.size());
+        segments_.push_back(segment);
+        segment_alive_.push_back(1);
+        witnessed_pairs_.emplace_back();
+        add_nodes(segment);
+        block_edges_with(slot);
+        int left = 2 + 2 * slot;
+        int right = left + 1;
+        for (int other = 0; other < right; ++other)
+        {
+            apply(other, right, evaluate(other, right));
+            if (other != left)
+            {
+                apply(other, left, evaluate(other, left));
+            }
+        }
+        return slot;
+    }
+
+    void IncrementalVisibilityGraph::remove_segment(int slot)
+    {
+        if (!is_segment_alive(slot))
+        {
+            throw std::runtime_error("No live segment in slot " + std::to_string(slot));
+        }
+        segment_alive_[slot] = 0;
+        for (int node = 2 + 2 * slot; node <= 3 + 2 * slot; ++node)
+        {
+            std::vector<Neighbor> row = rows_[node];
+            for (const auto& neighbor : row)
+            {
+                apply(node, neighbor.target, kDead);
+            }
+            mark_changed(node);
+        }
+        reevaluate_witnessed(slot);
+    }
+
+    void IncrementalVisibilityGraph::update_segment(int slot, const Segment& segment)
+    {
+        if (!is_segment_alive(slot))
+        {
+            throw std::runtime_error("No live segment in slot " + std::to_string(slot));
+        }
+        int left = 2 + 2 * slot;
+        segments_[slot] = segment;
+        nodes_[left] = GraphNode(segment.left, segment.order, true);
+        nodes_[left + 1] = GraphNode(segment.right, segment.order, false);
+        mark_changed(left);
+        mark_changed(left + 1);
+        reevaluate_witnessed(slot);
+        reevaluate_node_pairs(left);
+        reevaluate_node_pairs(left + 1);
+        block_edges_with(slot);
+    }
+
+    std::vector<Segment> IncrementalVisibilityGraph::get_live_segments() const
+    {
+        std::vector<Segment> live;
+        for (size_t slot = 0; slot < segments_.size(); ++slot)
+        {
+            if (segment_alive_[slot])
+            {
+                live.push_back(segments_[slot]);
+            }
+        }
+        return live;
+    }
+
+    std::vector<int> IncrementalVisibilityGraph::take_changed_nodes()
+    {
+        std::vector<int> changed;
+        changed.swap(changed_nodes_);
+        for (int node : changed)
+        {
+            changed_[node] = 0;
+        }
+        return changed;
+    }
+}
@@ -1,62 +1,415 @@
 #include "json_parser.h"
+#include "mapped_file.h"
+#include "chart_file.h"
+#include "metrics.h"
 #include <fstream>
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <cmath>
 using json = nlohmann::json;
 namespace marine_nav 
 {
-    InputData JsonParser::parse_input_file(const std::string& filename) 
+    namespace 
     {
-        std::ifstream file(filename);
-        if (!file.is_open()) 
+        // Collects the top-level "points", "start" and "end" members straight into their final
+        // containers. Keys and values anywhere else in the document are skipped.
+        class ChartSaxHandler : public nlohmann::json_sax<json> 
         {
-            throw std::runtime_error("Could not open file: " + filename);
+            private:
+                enum class Field { None, Label, X, Y };
+                std::vector<Point>& points_;
+                std::string& start_label_;
+                std::string& end_label_;
+                size_t depth_;
+                bool in_points_;
+                bool point_open_;
+                std::string top_key_;
+                Field field_;
+                std::string label_;
+                double x_;
+                double y_;
+                bool has_label_;
+                bool has_x_;
+                bool has_y_;
+
+                bool in_point() const 
+                {
+                    return point_open_ && depth_ == 3;
+                }
+
+                bool number(double value) 
+                {
+                    if (in_point()) 
+                    {
+                        if (field_ == Field::X) 
+                        {
+                            x_ = value;
+                            has_x_ = true;
+                        }
+                        else if (field_ == Field::Y) 
+                        {
+                            y_ = value;
+                            has_y_ = true;
+                        }
+                        else if (field_ == Field::Label) 
+                        {
+                            throw std::runtime_error("Point " + std::to_string(points_.size()) + " has a non-string label");
+                        }
+                    }
+                    return true;
+                }
+
+            public:
+                ChartSaxHandler(std::vector<Point>& points, std::string& start_label, std::string& end_label)
+                    : points_(points), start_label_(start_label), end_label_(end_label), depth_(0), in_points_(false), 
+                      point_open_(false), field_(Field::None), x_(0.0), y_(0.0), has_label_(false), has_x_(false), has_y_(false) {}
+
+                bool null() override 
+                {
+                    return true;
+                }
+
+                bool boolean(bool) override 
+                {
+                    return true;
+                }
+
+                bool number_integer(number_integer_t value) override 
+                {
+                    return number(static_cast<double>(value));
+                }
+
+                bool number_unsigned(number_unsigned_t value) override 
+                {
+                    return number(static_cast<double>(value));
+                }
+
+                bool number_float(number_float_t value, const string_t&) override 
+                {
+                    return number(value);
+                }
+
+                bool string(string_t& value) override 
+                {
+                    if (in_point()) 
+                    {
+                        if (field_ == Field::Label) 
+                        {
+                            label_ = std::move(value);
+                            has_label_ = true;
+                        }
+                        else if (field_ != Field::None) 
+                        {
+                            throw std::runtime_error("Point " + std::to_string(points_.size()) + " has a non-numeric coordinate");
+                        }
+                    }
+                    else if (depth_ == 1 && top_key_ == "start") 
+                    {
+                        start_label_ = std::move(value);
+                    }
+                    else if (depth_ == 1 && top_key_ == "end") 
+                    {
+                        end_label_ = std::move(value);
+                    }
+                    return true;
+                }
+
+                bool binary(binary_t&) override 
+                {
+                    return true;
+                }
+
+                bool start_object(std::size_t) override 
+                {
+                    ++depth_;
+                    if (in_points_ && depth_ == 3) 
+                    {
+                        point_open_ = true;
+                        field_ = Field::None;
+                        has_label_ = has_x_ = has_y_ = false;
+                    }
+                    return true;
+                }
+
+                bool key(string_t& value) override 
+                {
+                    if (depth_ == 1) 
+                    {
+                        top_key_ = std::move(value);
+                    }
+                    else if (in_point()) 
+                    {
+                        field_ = value == "label" ? Field::Label : value == "x" ? Field::X : value == "y" ? Field::Y : Field::None;
+                    }
+                    return true;
+                }
+
+                bool end_object() override 
+                {
+                    if (in_point()) 
+                    {
+                        if (!has_label_ || !has_x_ || !has_y_) 
+                        {
+                            throw std::runtime_error("Point " + std::to_string(points_.size()) + " needs a label, x and y");
+                        }
+                        points_.emplace_back(label_, x_, y_);
+                        point_open_ = false;
+                    }
+                    --depth_;
+                    return true;
+                }
+
+                bool start_array(std::size_t) override 
+                {
+                    if (depth_ == 1 && top_key_ == "points") 
+                    {
+                        in_points_ = true;
+                    }
+                    ++depth_;
+                    return true;
+                }
+
+                bool end_array() override 
+                {
+                    --depth_;
+                    if (in_points_ && depth_ == 1) 
+                    {
+                        in_points_ = false;
+                    }
+                    return true;
+                }
+
+                bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex) override 
+                {
+                    throw std::runtime_error(std::string("Invalid JSON input: ") + ex.what());
+                }
+        };
+    }
+
+    void JsonParser::parse_points(const char* begin, const char* end, std::vector<Point>& points, std::string& start_label, std::string& end_label) 
+    {
+        start_label = "FROM";
+        end_label = "TO";
+        ChartSaxHandler handler(points, start_label, end_label);
+        json::sax_parse(begin, end, &handler);
+    }
+
+    InputData JsonParser::parse_input_file(const std::string& filename, ParseStats* stats) 
+    {
+        MARINE_NAV_PHASE("parse");
+        auto parse_start = std::chrono::steady_clock::now();
+        MappedFile file(filename);
+        InputData input_data = parse_input_buffer(file.begin(), file.end());
+        if (stats) 
+        {
+            stats->bytes = file.size();
+            stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parse_start).count();
         }
-        json j;
-        file >> j;
-        return parse_input_string(j.dump());
+        return input_data;
     }
 
     InputData JsonParser::parse_input_string(const std::string& json_str) 
     {
-        json j = json::parse(json_str);
+        return parse_input_buffer(json_str.data(), json_str.data() + json_str.size());
+    }
+
+    InputData JsonParser::parse_input_buffer(const char* begin, const char* end) 
+    {
         std::vector<Point> points;
-        if (j.contains("points") && j["points"].is_array()) 
-        {
-            for (const auto& point_json : j["points"]) 
-            {
-                std::string label = point_json["label"];
-                double x = point_json["x"];
-                double y = point_json["y"];
-                points.emplace_back(label, x, y);
-            }
-        }
-        std::string start_label = j.value("start", "FROM");
-        std::string end_label = j.value("end", "TO");
+        std::string start_label;
+        std::string end_label;
+        parse_points(begin, end, points, start_label, end_label);
         Point start = find_point_by_label(points, start_label);
-        Point end = find_point_by_label(points, end_label);
-        InputData input_data(start, end);
-        input_data.points = points;
+        Point end_point = find_point_by_label(points, end_label);
+        InputData input_data(start, end_point);
         std::vector<Point> segment_points;
+        segment_points.reserve(points.size());
         for (const auto& point : points) 
         {
-            if (point.label != start_label && point.label != end_label) 
+            if (point.label_id != start.label_id && point.label_id != end_point.label_id) 
             {
                 segment_points.push_back(point);
             }
         }
-        input_data.segments = create_segments_from_points(segment_points);
+        input_data.segments = create_segments_from_points(std::move(segment_points));
+        input_data.points = std::move(points);
         return input_data;
     }
 
-    std::vector<Segment> JsonParser::create_segments_from_points(const std::vector<Point>& points) 
+    std::vector<Segment> JsonParser::parse_segments_file(const std::string& filename, ParseStats* stats) 
+    {
+        MARINE_NAV_PHASE("parse");
+        auto parse_start = std::chrono::steady_clock::now();
+        MappedFile file(filename);
+        std::vector<Point> points;
+        std::string start_label;
+        std::string end_label;
+        parse_points(file.begin(), file.end(), points, start_label, end_label);
+        uint32_t start_id = LabelTable::global().find(start_label);
+        uint32_t end_id = LabelTable::global().find(end_label);
+        points.erase(std::remove_if(points.begin(), points.end(), [&](const Point& point) 
+        {
+            return point.label_id == start_id || point.label_id == end_id;
+        }), points.end());
+        std::vector<Segment> segments = create_segments_from_points(std::move(points));
+        if (stats) 
+        {
+            stats->bytes = file.size();
+            stats->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parse_start).count();
+        }
+        return segments;
+    }
+
+    RouteQuery JsonParser::parse_route_query(const std::string& line, const std::string& fallback_id) 
+    {
+        static const uint32_t start_id = LabelTable::global().intern("FROM");
+        static const uint32_t end_id = LabelTable::global().intern("TO");
+        json j = json::parse(line);
+        auto read_point = [&j](const char* key, uint32_t label_id) 
+        {
+            if (!j.contains(key) || !j[key].is_object()) 
+            {
+                throw std::runtime_error(std::string("Route query is missing '") + key + "'");
+            }
+            const json& point_json = j[key];
+            return Point(label_id, point_json["x"].get<double>(), point_json["y"].get<double>());
+        };
+        auto read_label = [&j](const char* key, const char* default_label) 
+        {
+            return j[key].value("label", std::string(default_label));
+        };
+        std::string id = fallback_id;
+        if (j.contains("id")) 
+        {
+            id = j["id"].is_string() ? j["id"].get<std::string>() : j["id"].dump();
+        }
+        Point start = read_point("start", start_id);
+        Point end = read_point("end", end_id);
+        return RouteQuery(id, start, end, read_label("start", "FROM"), read_label("end", "TO"));
+    }
+
+    FleetQuery JsonParser::parse_fleet_file(const std::string& filename) 
+    {
+        std::ifstream file(filename);
+        if (!file.is_open()) 
+        {
+            throw std::runtime_error("Could not open file: " + filename);
+        }
+        json j = json::parse(file);
+        auto read_points = [&j](const char* key, const char* default_label) 
+        {
+            if (!j.contains(key) || !j[key].is_array()) 
+            {
+                throw std::runtime_error(std::string("Fleet file is missing '") + key + "'");
+            }
+            std::vector<Point> points;
+            points.reserve(j[key].size());
+            for (const json& point_json : j[key]) 
+            {
+                points.emplace_back(point_json.value("label", std::string(default_label)), point_json["x"].get<double>(), point_json["y"].get<double>());
+            }
+            return points;
+        };
+        FleetQuery query;
+        query.starts = read_points("starts", "FROM");
+        query.ends = read_points("ends", "TO");
+        return query;
+    }
+
+    SegmentUpdate JsonParser::parse_segment_update(const std::string& line) 
+    {
+        json j = json::parse(line);
+        SegmentUpdate update;
+        std::string op = j.value("op", std::string());
+        if (op == "insert") 
+        {
+            update.kind = SegmentUpdate::Kind::Insert;
+        }
+        else if (op == "remove") 
+        {
+            update.kind = SegmentUpdate::Kind::Remove;
+        }
+        else if (op == "update") 
+        {
+            update.kind = SegmentUpdate::Kind::Update;
+        }
+        else 
+        {
+            throw std::runtime_error("Segment update has unknown op '" + op + "'");
+        }
+        if (update.kind != SegmentUpdate::Kind::Insert) 
+        {
+            if (!j.contains("segment")) 
+            {
+                throw std::runtime_error("Segment update '" + op + "' is missing 'segment'");
+            }
+            update.slot = j["segment"].get<int>();
+        }
+        if (j.contains("order")) 
+        {
+            update.has_order = true;
+            update.order = j["order"].get<int>();
+        }
+        if (j.contains("left") && j.contains("right")) 
+        {
+            update.has_geometry = true;
+            update.left_label = j["left"].value("label", std::string());
+            update.left_x = j["left"]["x"].get<double>();
+            update.left_y = j["left"]["y"].get<double>();
+            update.right_label = j["right"].value("label", std::string());
+            update.right_x = j["right"]["x"].get<double>();
+            update.right_y = j["right"]["y"].get<double>();
+        }
+        if (update.kind == SegmentUpdate::Kind::Insert && (!update.has_geometry || !update.has_order)) 
+        {
+            throw std::runtime_error("Segment insert needs 'order', 'left' and 'right'");
+        }
+        if (update.kind == SegmentUpdate::Kind::Update && !update.has_geometry && !update.has_order) 
+        {
+            throw std::runtime_error("Segment update changes nothing");
+        }
+        return update;
+    }
+
+    std::string JsonParser::export_route_to_json_line(const RouteQuery& query, const std::vector<Point>& path, double total_distance, bool found) 
+    {
+        json result;
+        result["id"] = query.id;
+        result["found"] = found;
+        result["total_distance"] = found ? json(total_distance) : json(nullptr);
+        result["path"] = json::array();
+        for (size_t i = 0; i < path.size(); ++i) 
+        {
+            const Point& point = path[i];
+            json point_json;
+            point_json["label"] = i == 0 ? query.start_label : (i + 1 == path.size() ? query.end_label : point.label());
+            point_json["x"] = point.x;
+            point_json["y"] = point.y;
+            result["path"].push_back(point_json);
+        }
+        return result.dump();
+    }
+
+    std::vector<Segment> JsonParser::create_segments_from_points(std::vector<Point> sorted_points) 
     {
         std::vector<Segment> segments;
-        std::vector<Point> sorted_points = points;
-        std::sort(sorted_points.begin(), sorted_points.end(), [](const Point& a, const Point& b) 
+        segments.reserve(sorted_points.size() / 2);
+        // Resolve each label's text once so the sort compares strings without touching the table.
+        std::vector<std::pair<const std::string*, Point>> keyed;
+        keyed.reserve(sorted_points.size());
+        for (const auto& point : sorted_points) 
+        {
+            keyed.emplace_back(&point.label(), point);
+        }
+        std::sort(keyed.begin(), keyed.end(), [](const std::pair<const std::string*, Point>& a, const std::pair<const std::string*, Point>& b) 
         {
-            return a.label < b.label;
+            return *a.first < *b.first;
         });
+        for (size_t i = 0; i < keyed.size(); ++i) 
+        {
+            sorted_points[i] = keyed[i].second;
+        }
         for (size_t i = 0; i < sorted_points.size(); i += 2) 
         {
             if (i + 1 < sorted_points.size()) 
@@ -72,9 +425,10 @@ namespace marine_nav
 
     Point JsonParser::find_point_by_label(const std::vector<Point>& points, const std::string& label) 
     {
-        auto it = std::find_if(points.begin(), points.end(), [&label](const Point& p) 
+        uint32_t label_id = LabelTable::global().find(label);
+        auto it = std::find_if(points.begin(), points.end(), [label_id](const Point& p) 
         {
-            return p.label == label;
+            return p.label_id == label_id;
         });
         if (it != points.end()) 
         {
@@ -83,6 +437,11 @@ namespace marine_nav
         throw std::runtime_error("Point with label '" + label + "' not found");
     }
 
+    void JsonParser::export_chart_file(const InputData& input_data, const std::string& filename, const VisibilityGraph* graph) 
+    {
+        ChartFile::write(filename, input_data.segments, input_data.start, input_data.end, graph);
+    }
+
     std::string JsonParser::export_path_to_json(const std::vector<Point>& path, double total_distance) 
     {
         json result;    
@@ -91,7 +450,7 @@ namespace marine_nav
         for (const auto& point : path) 
         {
             json point_json;
-            point_json["label"] = point.label;
+            point_json["label"] = point.label();
             point_json["x"] = point.x;
             point_json["y"] = point.y;
             result["path"].push_back(point_json);
@@ -101,6 +460,7 @@ namespace marine_nav
 
     void JsonParser::export_path_to_file(const std::vector<Point>& path, double total_distance, const std::string& filename) 
     {
+        MARINE_NAV_PHASE("export");
         std::string json_str = export_path_to_json(path, total_distance);
         std::ofstream file(filename);
         if (!file.is_open()) 
@@ -111,4 +471,95 @@ namespace marine_nav
         file.close();
         std::cout << "Path exported to: " << filename << std::endl;
     }
-} 
+
+    void JsonParser::export_routes_to_file(const std::vector<std::vector<Point>>& paths, const std::vector<double>& distances, const std::string& filename) 
+    {
+        MARINE_NAV_PHASE("export");
+        auto path_json = [](const std::vector<Point>& path) 
+        {
+            json points = json::array();
+            for (const auto& point : path) 
+            {
+                json point_json;
+                point_json["label"] = point.label();
+                point_json["x"] = point.x;
+                point_json["y"] = point.y;
+                points.push_back(point_json);
+            }
+            return points;
+        };
+        json result;
+        if (!paths.empty()) 
+        {
+            result["total_distance"] = distances.front();
+            result["path"] = path_json(paths.front());
+        }
+        result["alternatives"] = json::array();
+        for (size_t i = 0; i < paths.size(); ++i) 
+        {
+            json route;
+            route["total_distance"] = distances[i];
+            route["path"] = path_json(paths[i]);
+            result["alternatives"].push_back(route);
+        }
+        std::ofstream file(filename);
+        if (!file.is_open()) 
+        {
+            throw std::runtime_error("Could not create output file: " + filename);
+        }
+        file << result.dump(2);
+        file.close();
+        std::cout << "Routes exported to: " << filename << std::endl;
+    }
+
+    void JsonParser::export_route_matrix_to_file(const std::vector<double>& costs, const std::vector<std::vector<Point>>& paths, size_t columns, const std::string& filename) 
+    {
+        MARINE_NAV_PHASE("export");
+        size_t rows = columns == 0 ? 0 : costs.size() / columns;
+        json result;
+        result["costs"] = json::array();
+        for (size_t i = 0; i < rows; ++i) 
+        {
+            json row = json::array();
+            for (size_t j = 0; j < columns; ++j) 
+            {
+                double cost = costs[i * columns + j];
+                row.push_back(std::isfinite(cost) ? json(cost) : json(nullptr));
+            }
+            result["costs"].push_back(row);
+        }
+        if (!paths.empty()) 
+        {
+            result["paths"] = json::array();
+            for (size_t i = 0; i < rows; ++i) 
+            {
+                json row = json::array();
+                for (size_t j = 0; j < columns; ++j) 
+                {
+                    json route;
+                    double cost = costs[i * columns + j];
+                    route["total_distance"] = std::isfinite(cost) ? json(cost) : json(nullptr);
+                    route["path"] = json::array();
+                    for (const auto& point : paths[i * columns + j]) 
+                    {
+                        json point_json;
+                        point_json["label"] = point.label();
+                        point_json["x"] = point.x;
+                        point_json["y"] = point.y;
+                        route["path"].push_back(point_json);
+                    }
+                    row.push_back(route);
+                }
+                result["paths"].push_back(row);
+            }
+        }
+        std::ofstream file(filename);
+        if (!file.is_open()) 
+        {
+            throw std::runtime_error("Could not create output file: " + filename);
+        }
+        file << result.dump(2);
+        file.close();
+        std::cout << "Route matrix exported to: " << filename << std::endl;
+    }
+}
@@ -0,0 +1,185 @@
+#include "k_shortest_paths.h"
+#include "graph_search.h"
+#include "metrics.h"
+#include <algorithm>
+#include <limits>
+#include <set>
+#include <stdexcept>
+namespace marine_nav
+{
+    KShortestPaths::KShortestPaths(const VisibilityGraph& graph)
+        : graph_(graph), blocked_generation_(0), spur_searches_(0), nodes_settled_(0)
+    {
+        if (graph_.is_lazy())
+        {
+            throw std::runtime_error("K shortest paths need an eager visibility graph");
+        }
+    }
+
+    double KShortestPaths::edge_weight(int from, int to) const
+    {
+        NeighborRange row = graph_.get_row(from);
+        const int* it = std::lower_bound(row.targets, row.targets + row.count, to);
+        return row.weights[it - row.targets];
+    }
+
+    void KShortestPaths::compute_tree(int target)
+    {
+        // Backwards from target: rows are sorted by target, so the entries below u are the nodes with a
+        // forward edge into u.
+        size_t num_nodes = graph_.get_node_count();
+        nodes_settled_ += search_from(workspace_, num_nodes, target, -1, [this](int u, const auto& relax)
+        {
+            NeighborRange row = graph_.get_row(u);
+            for (size_t k = 0; k < row.count && row.targets[k] < u; ++k)
+            {
+                relax(row.targets[k], row.weights[k]);
+            }
+        });
+        to_target_.resize(num_nodes);
+        for (size_t v = 0; v < num_nodes; ++v)
+        {
+            to_target_[v] = workspace_.distance(static_cast<int>(v));
+        }
+    }
+
+    double KShortestPaths::spur_search(int spur, int target, std::vector<int>& tail)
+    {
+        const double infinity = std::numeric_limits<double>::infinity();
+        ++spur_searches_;
+        nodes_settled_ += search_from(workspace_, graph_.get_node_count(), spur, target, [this, spur](int u, const auto& relax)
+        {
+            NeighborRange row = forward_part(graph_.get_row(u), u);
+            for (size_t k = 0; k < row.count; ++k)
+            {
+                int v = row.targets[k];
+                if (blocked_node_[v] == blocked_generation_)
+                {
+                    continue;
+                }
+                if (u == spur && std::find(blocked_edges_.begin(), blocked_edges_.end(), v) != blocked_edges_.end())
+                {
+                    continue;
+                }
+                relax(v, row.weights[k]);
+            }
+        }, [this](int node) { return to_target_[node]; });
+        double cost = workspace_.distance(target);
+        if (cost == infinity)
+        {
+            return cost;
+        }
+        size_t first = tail.size();
+        for (int node = target; node != spur; node = workspace_.previous(node))
+        {
+            tail.push_back(node);
+        }
+        std::reverse(tail.begin() + first, tail.end());
+        return cost;
+    }
+
+    PathResult KShortestPaths::to_result(const Route& route) const
+    {
+        PathResult result;
+        result.path.reserve(route.nodes.size());
+        for (int node : route.nodes)
+        {
+            result.path.push_back(graph_.get_node(node).point);
+        }
+        result.total_distance = route.cost;
+        result.found = true;
+        return result;
+    }
+
+    std::vector<PathResult> KShortestPaths::find(int source, int target, size_t k)
+    {
+        MARINE_NAV_PHASE("k_shortest_paths");
+        const double infinity = std::numeric_limits<double>::infinity();
+        spur_searches_ = 0;
+        nodes_settled_ = 0;
+        std::vector<PathResult> results;
+        if (k == 0)
+        {
+            return results;
+        }
+        compute_tree(target);
+        if (to_target_[source] == infinity)
+        {
+            return results;
+        }
+        blocked_node_.assign(graph_.get_node_count(), 0);
+        blocked_generation_ = 0;
+        // The best route follows the tree: from each node, step to a neighbour that keeps the remaining
+        // distance exact. The spur search does exactly that with nothing blocked.
+        ++blocked_generation_;
+        blocked_edges_.clear();
+        std::vector<Route> accepted(1);
+        accepted[0].nodes.push_back(source);
+        accepted[0].cost = spur_search(source, target, accepted[0].nodes);
+        auto fill_prefix = [this](Route& route)
+        {
+            route.prefix.assign(1, 0.0);
+            for (size_t i = 1; i < route.nodes.size(); ++i)
+            {
+                route.prefix.push_back(route.prefix.back() + edge_weight(route.nodes[i - 1], route.nodes[i]));
+            }
+        };
+        fill_prefix(accepted[0]);
+        // Candidates ordered by cost then node sequence; the same sequence is never queued twice.
+        std::set<std::pair<double, std::vector<int>>> candidates;
+        std::set<std::vector<int>> seen;
+        seen.insert(accepted[0].nodes);
+        while (accepted.size() < k)
+        {
+            const Route& last = accepted.back();
+            for (size_t i = 0; i + 1 < last.nodes.size(); ++i)
+            {
+                int spur = last.nodes[i];
+                // Each accepted route sharing this root leaves the spur node along an edge that must not
+                // be reused, and the root's own nodes may not be revisited.
+                blocked_edges_.clear();
+                for (const Route& route : accepted)
+                {
+                    if (route.nodes.size() > i + 1 && std::equal(last.nodes.begin(), last.nodes.begin() + i + 1, route.nodes.begin()))
+                    {
+                        blocked_edges_.push_back(route.nodes[i + 1]);
+                    }
+                }
+                if (++blocked_generation_ == 0)
+                {
+                    std::fill(blocked_node_.begin(), blocked_node_.end(), 0);
+                    blocked_generation_ = 1;
+                }
+                for (size_t r = 0; r < i; ++r)
+                {
+                    blocked_node_[last.nodes[r]] = blocked_generation_;
+                }
+                std::vector<int> nodes(last.nodes.begin(), last.nodes.begin() + i + 1);
+                double spur_cost = spur_search(spur, target, nodes);
+                if (spur_cost == infinity || !seen.insert(nodes).second)
+                {
+                    continue;
+                }
+                double cost = last.prefix[i] + spur_cost;
+                candidates.emplace(cost, std::move(nodes));
+            }
+            if (candidates.empty())
+            {
+                break;
+            }
+            auto best = candidates.begin();
+            Route route;
+            route.nodes = best->second;
+            route.cost = best->first;
+            candidates.erase(best);
+            fill_prefix(route);
+            accepted.push_back(std::move(route));
+        }
+        results.reserve(accepted.size());
+        for (const Route& route : accepted)
+        {
+            results.push_back(to_result(route));
+        }
+        return results;
+    }
+}
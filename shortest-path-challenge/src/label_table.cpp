@@ -0,0 +1,76 @@
+#include "label_table.h"
+#include <stdexcept>
+namespace marine_nav
+{
+    LabelTable& LabelTable::global()
+    {
+        static LabelTable table;
+        return table;
+    }
+
+    uint32_t LabelTable::intern(const std::string& label)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return intern_locked(label);
+    }
+
+    uint32_t LabelTable::intern_locked(const std::string& label)
+    {
+        auto it = ids_.find(label);
+        if (it != ids_.end())
+        {
+            return it->second;
+        }
+        if (names_.size() >= kNotFound)
+        {
+            throw std::runtime_error("Label table is full");
+        }
+        uint32_t id = static_cast<uint32_t>(names_.size());
+        names_.push_back(label);
+        ids_.emplace(label, id);
+        return id;
+    }
+
+    uint32_t LabelTable::find(const std::string& label) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = ids_.find(label);
+        return it == ids_.end() ? kNotFound : it->second;
+    }
+
+    uint32_t LabelTable::crossing(int order)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = crossing_ids_.find(order);
+        if (it != crossing_ids_.end())
+        {
+            return it->second;
+        }
+        uint32_t id = intern_locked("crossing_" + std::to_string(order));
+        crossing_ids_.emplace(order, id);
+        return id;
+    }
+
+    uint32_t LabelTable::find_crossing(int order) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = crossing_ids_.find(order);
+        return it == crossing_ids_.end() ? kNotFound : it->second;
+    }
+
+    const std::string& LabelTable::name(uint32_t id) const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (id >= names_.size())
+        {
+            throw std::runtime_error("Unknown label id: " + std::to_string(id));
+        }
+        return names_[id];
+    }
+
+    size_t LabelTable::size() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return names_.size();
+    }
+}
@@ -0,0 +1,205 @@
+#include "lpa_star.h"
+#include <algorithm>
+#include <functional>
+#include <limits>
+namespace marine_nav
+{
+    namespace
+    {
+        const int kStart = 0;
+        const int kGoal = 1;
+        const double kInfinity = std::numeric_limits<double>::infinity();
+    }
+
+    LpaStarSolver::LpaStarSolver(IncrementalVisibilityGraph& graph) : graph_(graph), initialized_(false) {}
+
+    LpaStarSolver::Key LpaStarSolver::calculate_key(int node) const
+    {
+        double best = std::min(g_[node], rhs_[node]);
+        return Key{best + heuristic_[node], best};
+    }
+
+    void LpaStarSolver::grow()
+    {
+        size_t count = graph_.get_node_count();
+        const Point& goal = graph_.get_node(kGoal).point;
+        for (size_t node = g_.size(); node < count; ++node)
+        {
+            heuristic_.push_back(graph_.get_node(static_cast<int>(node)).point.distance_to(goal));
+        }
+        g_.resize(count, kInfinity);
+        rhs_.resize(count, kInfinity);
+        queued_key_.resize(count, Key{kInfinity, kInfinity});
+        queued_.resize(count, 0);
+    }
+
+    void LpaStarSolver::push(int node)
+    {
+        Key key = calculate_key(node);
+        queued_key_[node] = key;
+        queued_[node] = 1;
+        queue_.push_back(QueueEntry{key, node});
+        std::push_heap(queue_.begin(), queue_.end(), std::greater<QueueEntry>());
+    }
+
+    void LpaStarSolver::update_vertex(int node)
+    {
+        if (node != kStart)
+        {
+            double best = kInfinity;
+            for (const auto& neighbor : graph_.get_neighbors(node))
+            {
+                best = std::min(best, g_[neighbor.target] + neighbor.weight);
+            }
+            rhs_[node] = best;
+        }
+        requeue(node);
+    }
+
+    void LpaStarSolver::requeue(int node)
+    {
+        if (g_[node] != rhs_[node])
+        {
+            push(node);
+        }
+        else
+        {
+            queued_[node] = 0;
+        }
+    }
+
+    bool LpaStarSolver::top(QueueEntry& entry)
+    {
+        while (!queue_.empty())
+        {
+            const QueueEntry& front = queue_.front();
+            if (queued_[front.node] && queued_key_[front.node] == front.key)
+            {
+                entry = front;
+                return true;
+            }
+            std::pop_heap(queue_.begin(), queue_.end(), std::greater<QueueEntry>());
+            queue_.pop_back();
+        }
+        return false;
+    }
+
+    size_t LpaStarSolver::compute_shortest_path()
+    {
+        size_t expanded = 0;
+        QueueEntry entry;
+        while (top(entry) && (entry.key < calculate_key(kGoal) || rhs_[kGoal] != g_[kGoal]))
+        {
+            std::pop_heap(queue_.begin(), queue_.end(), std::greater<QueueEntry>());
+            queue_.pop_back();
+            int u = entry.node;
+            queued_[u] = 0;
+            ++expanded;
+            if (g_[u] > rhs_[u])
+            {
+                // Overconsistent: u's distance drops, which can only lower its neighbours' rhs.
+                g_[u] = rhs_[u];
+                for (const auto& neighbor : graph_.get_neighbors(u))
+                {
+                    int v = neighbor.target;
+                    if (v != kStart && g_[u] + neighbor.weight < rhs_[v])
+                    {
+                        rhs_[v] = g_[u] + neighbor.weight;
+                        requeue(v);
+                    }
+                }
+            }
+            else
+            {
+                // Underconsistent: only neighbours whose rhs came through u need a full recompute.
+                double old_g = g_[u];
+                g_[u] = kInfinity;
+                update_vertex(u);
+                for (const auto& neighbor : graph_.get_neighbors(u))
+                {
+                    int v = neighbor.target;
+                    if (v != kStart && rhs_[v] == old_g + neighbor.weight)
+                    {
+                        update_vertex(v);
+                    }
+                }
+            }
+        }
+        return expanded;
+    }
+
+    std::vector<Point> LpaStarSolver::extract_path() const
+    {
+        std::vector<int> nodes(1, kGoal);
+        int current = kGoal;
+        while (current != kStart && nodes.size() <= g_.size())
+        {
+            int best = -1;
+            double best_distance = kInfinity;
+            for (const auto& neighbor : graph_.get_neighbors(current))
+            {
+                double distance = g_[neighbor.target] + neighbor.weight;
+                if (distance < best_distance)
+                {
+                    best_distance = distance;
+                    best = neighbor.target;
+                }
+            }
+            if (best == -1)
+            {
+                return std::vector<Point>();
+            }
+            nodes.push_back(best);
+            current = best;
+        }
+        std::vector<Point> path;
+        path.reserve(nodes.size());
+        for (auto it = nodes.rbegin(); it != nodes.rend(); ++it)
+        {
+            path.push_back(graph_.get_node(*it).point);
+        }
+        return path;
+    }
+
+    PathResult LpaStarSolver::solve()
+    {
+        PathResult result;
+        if (!initialized_)
+        {
+            g_.clear();
+            rhs_.clear();
+            heuristic_.clear();
+            queued_key_.clear();
+            queued_.clear();
+            queue_.clear();
+            grow();
+            graph_.take_changed_nodes();
+            rhs_[kStart] = 0.0;
+            push(kStart);
+            initialized_ = true;
+        }
+        else
+        {
+            grow();
+            std::vector<int> changed = graph_.take_changed_nodes();
+            const Point& goal = graph_.get_node(kGoal).point;
+            for (int node : changed)
+            {
+                heuristic_[node] = graph_.get_node(node).point.distance_to(goal);
+            }
+            for (int node : changed)
+            {
+                update_vertex(node);
+            }
+        }
+        result.nodes_settled = compute_shortest_path();
+        if (g_[kGoal] == kInfinity)
+        {
+            return result;
+        }
+        result.path = extract_path();
+        result.found = !result.path.empty();
+        result.total_distance = result.found ? g_[kGoal] : kInfinity;
+        return result;
+    }
+}
@@ -1,16 +1,99 @@
 #include "json_parser.h"
+#include "geodesic.h"
 #include "shortest_path.h"
+#include "route_service.h"
+#include "chart_file.h"
+#include "lpa_star.h"
+#include "windowed_solver.h"
+#include "metrics.h"
 #include <iostream>
 #include <chrono>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <memory>
 using namespace marine_nav;
 void print_usage(const char* program_name) 
 {
-    std::cout << "Usage: " << program_name << " <input_file.json> [output_file.json]\n";
-    std::cout << "  input_file.json  - JSON file containing points and start/end labels\n";
+    std::cout << "Usage: " << program_name << " [options] <input_file.json> [output_file.json]\n";
+    std::cout << "       " << program_name << " [options] --batch <queries.jsonl> <input_file.json> [results.jsonl]\n";
+    std::cout << "       " << program_name << " [options] --matrix <fleet.json> <input_file.json> [matrix.json]\n";
+    std::cout << "  input_file.json  - JSON file containing points and start/end labels, or a chart from --write-chart\n";
     std::cout << "  output_file.json - Optional output file for the result (default: output.json)\n";
+    std::cout << "Options:\n";
+    std::cout << "  --geometry <native|geos|scalar|sse2|avx2>               - Intersection engine (default: native, best SIMD level)\n";
+    std::cout << "  --threads <n>                                           - Graph construction threads, 0 = all cores (default: 1)\n";
+    std::cout << "  --no-spatial-index                                      - Scan every segment instead of querying the R-tree\n";
+    std::cout << "  --lazy                                                  - Evaluate edges on demand while searching\n";
+    std::cout << "  --staged-constraints                                    - Check orientation and crossings in separate passes (pre-fusion pipeline)\n";
+    std::cout << "  --coordinates <planar|geographic>                       - Geographic reads x as longitude and y as latitude in degrees, routes in a local projection and weighs legs in great-circle metres (default: planar)\n";
+    std::cout << "  --batch <queries.jsonl>                                 - Answer one route per line over the input's gateways; results stream as JSON lines (default: stdout)\n";
+    std::cout << "  --oracle <file.oracle>                                  - With --batch: answer distances from a precomputed gateway distance oracle, built and written first if the file does not exist\n";
+    std::cout << "  --matrix <fleet.json>                                   - Route every start to every end over the input's gateways; writes the cost and route matrix (default: matrix.json)\n";
+    std::cout << "  --updates <updates.jsonl>                               - Plan once, then apply each gateway insert/remove/update line and replan incrementally (LPA*)\n";
+    std::cout << "  --write-chart <file.chart>                              - Save the segments and visibility graph as a binary chart; pass a chart as input to skip parsing and graph construction\n";
+    std::cout << "  --alternatives <k>                                      - Up to k shortest loopless routes from one eager graph (Yen); all are written to the output\n";
+    std::cout << "  --search <dijkstra|astar|corridor|layered|continuous|windowed> - Search algorithm (default: dijkstra)\n";
+    std::cout << "  --window <W>[,<L>]                                      - Windowed search: W gateways per window, L shared with the next (default: 256,16)\n";
+    std::cout << "  --stats <stats.json>                                    - Write hot-path counters and per-phase times as JSON\n";
+    std::cout << "  --trace <trace.json>                                    - Write a Chrome trace-event file of the run's phases\n";
 }
 
-void print_path_info(const PathResult& result) 
+bool configure_geometry(GeometryEngine& engine, const std::string& name) 
+{
+    if (name == "geos") 
+    {
+        engine.set_intersection_backend(IntersectionBackend::Geos);
+        return true;
+    }
+    engine.set_intersection_backend(IntersectionBackend::Native);
+    if (name == "native") 
+    {
+        return true;
+    }
+    if (name == "scalar") 
+    {
+        engine.set_simd_level(SimdLevel::Scalar);
+        return true;
+    }
+    if (name == "sse2") 
+    {
+        engine.set_simd_level(SimdLevel::SSE2);
+        return true;
+    }
+    if (name == "avx2") 
+    {
+        engine.set_simd_level(SimdLevel::AVX2);
+        return true;
+    }
+    return false;
+}
+
+// Writes whichever of --stats / --trace was requested; a failure here does not change the exit status.
+void write_metrics(const std::string& stats_file, const std::string& trace_file) 
+{
+    try 
+    {
+        if (!stats_file.empty()) 
+        {
+            Metrics::write_stats(stats_file);
+            std::cerr << "Stats written to: " << stats_file << (Metrics::is_enabled() ? "" : " (metrics compiled out)") << "\n";
+        }
+        if (!trace_file.empty()) 
+        {
+            Metrics::write_trace(trace_file);
+            std::cerr << "Trace written to: " << trace_file << "\n";
+        }
+    }
+    catch (const std::exception& e) 
+    {
+        std::cerr << "Error: " << e.what() << std::endl;
+    }
+}
+
+// With a projection the path is planar in it: points are shown as longitude/latitude and legs in
+// great-circle metres.
+void print_path_info(const PathResult& result, const LocalProjection* projection = nullptr) 
 {
     if (!result.found) 
     {
@@ -22,75 +105,682 @@ void print_path_info(const PathResult& result)
     std::cout << "Path (" << result.path.size() << " points):\n";
     for (size_t i = 0; i < result.path.size(); ++i) 
     {
-        const auto& point = result.path[i];
-        std::cout << "  " << (i + 1) << ". " << point.label 
+        Point point = projection ? projection->unproject(result.path[i]) : result.path[i];
+        std::cout << "  " << (i + 1) << ". " << point.label() 
                   << " (" << point.x << ", " << point.y << ")";
         if (i < result.path.size() - 1) 
         {
-            double segment_distance = point.distance_to(result.path[i + 1]);
+            double segment_distance = projection ? GeodesicKernel::distance(point, projection->unproject(result.path[i + 1])) 
+                                                 : point.distance_to(result.path[i + 1]);
             std::cout << " -> distance: " << segment_distance;
         }
         std::cout << "\n";
     }
 }
 
+// Configures service and loads the input's gateways (JSON or chart); false on an unknown geometry mode.
+bool load_service(RouteService& service, const std::string& input_file, const std::string& geometry_mode, size_t thread_count, bool spatial_index) 
+{
+    if (!configure_geometry(service.get_geometry_engine(), geometry_mode)) 
+    {
+        std::cerr << "Unknown geometry mode: " << geometry_mode << "\n";
+        return false;
+    }
+    service.get_geometry_engine().set_spatial_index(spatial_index);
+    service.set_thread_count(thread_count);
+    auto load_start = std::chrono::high_resolution_clock::now();
+    if (ChartFile::is_chart_file(input_file)) 
+    {
+        service.load(ChartFile(input_file).load_segments());
+    }
+    else 
+    {
+        ParseStats parse_stats;
+        service.load(JsonParser::parse_segments_file(input_file, &parse_stats));
+        std::cerr << "Parsed " << parse_stats.bytes << " bytes in " << parse_stats.seconds * 1000.0 
+                  << " ms (" << parse_stats.megabytes_per_second() << " MB/s)\n";
+    }
+    auto load_end = std::chrono::high_resolution_clock::now();
+    std::cerr << "Loaded " << service.get_segments().size() << " gateway segments in " 
+              << std::chrono::duration_cast<std::chrono::milliseconds>(load_end - load_start).count() << " ms\n";
+    return true;
+}
+
+int run_batch(const std::string& input_file, const std::string& queries_file, const std::string& output_file, 
+              const std::string& geometry_mode, size_t thread_count, bool spatial_index, const std::string& oracle_file) 
+{
+    const size_t chunk_size = 1024;
+    RouteService service;
+    if (!load_service(service, input_file, geometry_mode, thread_count, spatial_index)) 
+    {
+        return 1;
+    }
+    if (!oracle_file.empty()) 
+    {
+        auto oracle_start = std::chrono::high_resolution_clock::now();
+        bool reuse = std::ifstream(oracle_file).good();
+        if (reuse) 
+        {
+            service.load_oracle(oracle_file);
+        }
+        else 
+        {
+            service.build_oracle();
+            service.get_oracle().write(oracle_file);
+        }
+        auto oracle_end = std::chrono::high_resolution_clock::now();
+        std::cerr << (reuse ? "Mapped" : "Built and wrote") << " distance oracle " << oracle_file << " (" 
+                  << service.get_oracle().get_node_count() << " nodes) in " 
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(oracle_end - oracle_start).count() << " ms\n";
+    }
+    std::ifstream queries(queries_file);
+    if (!queries.is_open()) 
+    {
+        std::cerr << "Error: Could not open file: " << queries_file << "\n";
+        return 1;
+    }
+    std::ofstream file_out;
+    if (!output_file.empty()) 
+    {
+        file_out.open(output_file);
+        if (!file_out.is_open()) 
+        {
+            std::cerr << "Error: Could not create output file: " << output_file << "\n";
+            return 1;
+        }
+    }
+    std::ostream& out = output_file.empty() ? std::cout : file_out;
+    size_t line_number = 0;
+    size_t answered = 0;
+    size_t found = 0;
+    std::string line;
+    std::vector<RouteQuery> chunk;
+    auto flush_chunk = [&]() 
+    {
+        std::vector<std::pair<Point, Point>> endpoints;
+        endpoints.reserve(chunk.size());
+        for (const auto& query : chunk) 
+        {
+            endpoints.emplace_back(query.start, query.end);
+        }
+        if (service.get_oracle().is_ready()) 
+        {
+            // Distances only: the oracle does not keep the routes.
+            std::vector<double> distances = service.route_distance_batch(endpoints);
+            for (size_t i = 0; i < chunk.size(); ++i) 
+            {
+                bool routed = distances[i] != std::numeric_limits<double>::infinity();
+                out << JsonParser::export_route_to_json_line(chunk[i], {}, distances[i], routed) << "\n";
+                found += routed ? 1 : 0;
+            }
+        }
+        else 
+        {
+            std::vector<PathResult> results = service.route_batch(endpoints);
+            for (size_t i = 0; i < chunk.size(); ++i) 
+            {
+                out << JsonParser::export_route_to_json_line(chunk[i], results[i].path, results[i].total_distance, results[i].found) << "\n";
+                found += results[i].found ? 1 : 0;
+            }
+        }
+        out.flush();
+        answered += chunk.size();
+        chunk.clear();
+    };
+    auto batch_start = std::chrono::high_resolution_clock::now();
+    while (std::getline(queries, line)) 
+    {
+        ++line_number;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) 
+        {
+            continue;
+        }
+        chunk.push_back(JsonParser::parse_route_query(line, std::to_string(line_number)));
+        if (chunk.size() == chunk_size) 
+        {
+            flush_chunk();
+        }
+    }
+    if (!chunk.empty()) 
+    {
+        flush_chunk();
+    }
+    auto batch_end = std::chrono::high_resolution_clock::now();
+    std::cerr << "Answered " << answered << " queries (" << found << " routed) in " 
+              << std::chrono::duration_cast<std::chrono::milliseconds>(batch_end - batch_start).count() << " ms\n";
+    return 0;
+}
+
+int run_matrix(const std::string& input_file, const std::string& fleet_file, const std::string& output_file, 
+               const std::string& geometry_mode, size_t thread_count, bool spatial_index) 
+{
+    RouteService service;
+    if (!load_service(service, input_file, geometry_mode, thread_count, spatial_index)) 
+    {
+        return 1;
+    }
+    FleetQuery fleet = JsonParser::parse_fleet_file(fleet_file);
+    auto matrix_start = std::chrono::high_resolution_clock::now();
+    RouteMatrix matrix = service.route_matrix(fleet.starts, fleet.ends);
+    auto matrix_end = std::chrono::high_resolution_clock::now();
+    size_t routed = 0;
+    std::vector<std::vector<Point>> paths;
+    paths.reserve(matrix.paths.size());
+    for (const auto& result : matrix.paths) 
+    {
+        routed += result.found ? 1 : 0;
+        paths.push_back(result.path);
+    }
+    std::cerr << "Routed " << routed << " of " << matrix.rows << " x " << matrix.cols << " pairs in " 
+              << std::chrono::duration_cast<std::chrono::milliseconds>(matrix_end - matrix_start).count() << " ms\n";
+    JsonParser::export_route_matrix_to_file(matrix.costs, paths, matrix.cols, output_file.empty() ? "matrix.json" : output_file);
+    return 0;
+}
+
+int run_updates(const std::string& input_file, const std::string& updates_file, const std::string& output_file) 
+{
+    InputData input_data(Point("", 0.0, 0.0), Point("", 0.0, 0.0));
+    if (ChartFile::is_chart_file(input_file)) 
+    {
+        ChartFile chart(input_file);
+        input_data = InputData(chart.get_start(), chart.get_end());
+        input_data.segments = chart.load_segments();
+    }
+    else 
+    {
+        input_data = JsonParser::parse_input_file(input_file);
+    }
+    std::ifstream updates(updates_file);
+    if (!updates.is_open()) 
+    {
+        std::cerr << "Error: Could not open file: " << updates_file << "\n";
+        return 1;
+    }
+    auto report = [](const PathResult& result) 
+    {
+        if (result.found) 
+        {
+            std::cout << "distance " << result.total_distance;
+        }
+        else 
+        {
+            std::cout << "no route";
+        }
+        std::cout << ", " << result.nodes_settled << " nodes expanded";
+    };
+    IncrementalVisibilityGraph graph;
+    auto build_start = std::chrono::high_resolution_clock::now();
+    graph.build(input_data.segments, input_data.start, input_data.end);
+    LpaStarSolver planner(graph);
+    PathResult result = planner.solve();
+    auto build_end = std::chrono::high_resolution_clock::now();
+    std::cout << "Initial plan: ";
+    report(result);
+    std::cout << ", " << graph.get_edge_count() << " edges, " << graph.get_pairs_evaluated() << " pairs evaluated in " 
+              << std::chrono::duration_cast<std::chrono::milliseconds>(build_end - build_start).count() << " ms\n";
+    size_t line_number = 0;
+    std::string line;
+    while (std::getline(updates, line)) 
+    {
+        ++line_number;
+        if (line.find_first_not_of(" \t\r") == std::string::npos) 
+        {
+            continue;
+        }
+        SegmentUpdate update = JsonParser::parse_segment_update(line);
+        size_t pairs_before = graph.get_pairs_evaluated();
+        size_t checks_before = graph.get_segment_checks();
+        auto update_start = std::chrono::high_resolution_clock::now();
+        if (update.kind == SegmentUpdate::Kind::Remove) 
+        {
+            graph.remove_segment(update.slot);
+        }
+        else 
+        {
+            int slot = update.kind == SegmentUpdate::Kind::Insert ? static_cast<int>(graph.get_segment_slot_count()) : update.slot;
+            if (update.kind == SegmentUpdate::Kind::Update && !graph.is_segment_alive(slot)) 
+            {
+                throw std::runtime_error("No live segment in slot " + std::to_string(slot));
+            }
+            const GraphNode* left = update.kind == SegmentUpdate::Kind::Update ? &graph.get_node(2 + 2 * slot) : nullptr;
+            const GraphNode* right = update.kind == SegmentUpdate::Kind::Update ? &graph.get_node(3 + 2 * slot) : nullptr;
+            auto endpoint = [&](const GraphNode* current, const std::string& label, double x, double y, const char* side) 
+            {
+                uint32_t label_id = !label.empty() ? LabelTable::global().intern(label) 
+                                  : current ? current->point.label_id 
+                                  : LabelTable::global().intern("gateway_" + std::to_string(slot) + side);
+                return update.has_geometry ? Point(label_id, x, y) : Point(label_id, current->point.x, current->point.y);
+            };
+            Segment segment(endpoint(left, update.left_label, update.left_x, update.left_y, "_left"), 
+                            endpoint(right, update.right_label, update.right_x, update.right_y, "_right"), 
+                            update.has_order ? update.order : left->segment_order);
+            if (update.kind == SegmentUpdate::Kind::Insert) 
+            {
+                graph.insert_segment(segment);
+            }
+            else 
+            {
+                graph.update_segment(slot, segment);
+            }
+        }
+        result = planner.solve();
+        auto update_end = std::chrono::high_resolution_clock::now();
+        std::cout << "Update " << line_number << ": ";
+        report(result);
+        std::cout << ", " << graph.get_pairs_evaluated() - pairs_before << " pairs re-evaluated, " 
+                  << graph.get_segment_checks() - checks_before << " segment checks in " 
+                  << std::chrono::duration_cast<std::chrono::microseconds>(update_end - update_start).count() << " us\n";
+    }
+    if (result.found && !output_file.empty()) 
+    {
+        JsonParser::export_path_to_file(result.path, result.total_distance, output_file);
+    }
+    return result.found ? 0 : 1;
+}
+
 int main(int argc, char* argv[]) 
 {
-    if (argc < 2) 
+    std::vector<std::string> positional;
+    std::string geometry_mode = "native";
+    size_t thread_count = 1;
+    bool lazy_graph = false;
+    bool spatial_index = true;
+    bool staged_constraints = false;
+    std::string search_mode = "dijkstra";
+    std::string coordinates = "planar";
+    size_t window_size = 256;
+    size_t window_overlap = 16;
+    size_t alternatives = 0;
+    std::string batch_file;
+    std::string matrix_file;
+    std::string oracle_file;
+    std::string chart_file;
+    std::string updates_file;
+    std::string stats_file;
+    std::string trace_file;
+    for (int i = 1; i < argc; ++i) 
+    {
+        if (std::strcmp(argv[i], "--geometry") == 0 && i + 1 < argc) 
+        {
+            geometry_mode = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) 
+        {
+            thread_count = std::stoul(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--batch") == 0 && i + 1 < argc) 
+        {
+            batch_file = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--matrix") == 0 && i + 1 < argc) 
+        {
+            matrix_file = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--oracle") == 0 && i + 1 < argc) 
+        {
+            oracle_file = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--updates") == 0 && i + 1 < argc) 
+        {
+            updates_file = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--write-chart") == 0 && i + 1 < argc) 
+        {
+            chart_file = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--search") == 0 && i + 1 < argc) 
+        {
+            search_mode = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--coordinates") == 0 && i + 1 < argc) 
+        {
+            coordinates = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--window") == 0 && i + 1 < argc) 
+        {
+            std::string value = argv[++i];
+            size_t comma = value.find(',');
+            window_size = std::stoul(value.substr(0, comma));
+            if (comma != std::string::npos) 
+            {
+                window_overlap = std::stoul(value.substr(comma + 1));
+            }
+        }
+        else if (std::strcmp(argv[i], "--alternatives") == 0 && i + 1 < argc) 
+        {
+            alternatives = std::stoul(argv[++i]);
+        }
+        else if (std::strcmp(argv[i], "--stats") == 0 && i + 1 < argc) 
+        {
+            stats_file = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--trace") == 0 && i + 1 < argc) 
+        {
+            trace_file = argv[++i];
+        }
+        else if (std::strcmp(argv[i], "--no-spatial-index") == 0) 
+        {
+            spatial_index = false;
+        }
+        else if (std::strcmp(argv[i], "--lazy") == 0) 
+        {
+            lazy_graph = true;
+        }
+        else if (std::strcmp(argv[i], "--staged-constraints") == 0) 
+        {
+            staged_constraints = true;
+        }
+        else if (std::strncmp(argv[i], "--", 2) == 0) 
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
+        else 
+        {
+            positional.push_back(argv[i]);
+        }
+    }
+    if (positional.empty()) 
     {
         print_usage(argv[0]);
         return 1;
     }
-    std::string input_file = argv[1];
-    std::string output_file = (argc >= 3) ? argv[2] : "output.json";
+    std::string input_file = positional[0];
+    if (coordinates != "planar" && coordinates != "geographic") 
+    {
+        std::cerr << "Unknown coordinate system: " << coordinates << "\n";
+        return 1;
+    }
+    bool geographic = coordinates == "geographic";
+    if (geographic && (!batch_file.empty() || !matrix_file.empty() || !updates_file.empty() || !chart_file.empty() || ChartFile::is_chart_file(input_file))) 
+    {
+        std::cerr << "Geographic coordinates are supported for single routes over JSON input only\n";
+        return 1;
+    }
+    if (geographic && search_mode != "dijkstra" && search_mode != "layered" && search_mode != "windowed") 
+    {
+        // The A* heuristics and continuous crossings measure planar distances.
+        std::cerr << "Geographic coordinates need --search dijkstra, layered or windowed\n";
+        return 1;
+    }
+    Metrics::set_tracing(!trace_file.empty());
+    if (!batch_file.empty()) 
+    {
+        try 
+        {
+            int status = run_batch(input_file, batch_file, positional.size() >= 2 ? positional[1] : "", geometry_mode, thread_count, spatial_index, oracle_file);
+            write_metrics(stats_file, trace_file);
+            return status;
+        }
+        catch (const std::exception& e) 
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if (!matrix_file.empty()) 
+    {
+        try 
+        {
+            int status = run_matrix(input_file, matrix_file, positional.size() >= 2 ? positional[1] : "", geometry_mode, thread_count, spatial_index);
+            write_metrics(stats_file, trace_file);
+            return status;
+        }
+        catch (const std::exception& e) 
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if (!updates_file.empty()) 
+    {
+        try 
+        {
+            int status = run_updates(input_file, updates_file, positional.size() >= 2 ? positional[1] : "");
+            write_metrics(stats_file, trace_file);
+            return status;
+        }
+        catch (const std::exception& e) 
+        {
+            std::cerr << "Error: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    std::string output_file = (positional.size() >= 2) ? positional[1] : "output.json";
     try 
     {
         std::cout << "Marine Navigation Shortest Path Solver\n";
         std::cout << "======================================\n\n";
         std::cout << "Loading input from: " << input_file << "\n";
         auto start_time = std::chrono::high_resolution_clock::now();
-        InputData input_data = JsonParser::parse_input_file(input_file);
-        std::cout << "Loaded " << input_data.points.size() << " points\n";
+        std::unique_ptr<ChartFile> chart;
+        InputData input_data(Point("", 0.0, 0.0), Point("", 0.0, 0.0));
+        if (ChartFile::is_chart_file(input_file)) 
+        {
+            auto map_start = std::chrono::high_resolution_clock::now();
+            chart.reset(new ChartFile(input_file));
+            input_data = InputData(chart->get_start(), chart->get_end());
+            input_data.segments = chart->load_segments();
+            input_data.points.push_back(input_data.start);
+            for (const auto& segment : input_data.segments) 
+            {
+                input_data.points.push_back(segment.left);
+                input_data.points.push_back(segment.right);
+            }
+            input_data.points.push_back(input_data.end);
+            auto map_end = std::chrono::high_resolution_clock::now();
+            std::cout << "Loaded " << input_data.points.size() << " points\n";
+            std::cout << "Mapped chart v" << chart->get_version() << " (" << chart->get_file_size() << " bytes, " 
+                      << chart->get_label_count() << " labels, " << (chart->has_graph() ? "precomputed graph" : "no graph") << ") in " 
+                      << std::chrono::duration<double, std::milli>(map_end - map_start).count() << " ms\n";
+        }
+        else 
+        {
+            ParseStats parse_stats;
+            input_data = JsonParser::parse_input_file(input_file, &parse_stats);
+            std::cout << "Loaded " << input_data.points.size() << " points\n";
+            std::cout << "Parsed " << parse_stats.bytes << " bytes in " << parse_stats.seconds * 1000.0 
+                      << " ms (" << parse_stats.megabytes_per_second() << " MB/s)\n";
+        }
         std::cout << "Created " << input_data.segments.size() << " gateway segments\n";
-        std::cout << "Start: " << input_data.start.label 
+        std::cout << "Start: " << input_data.start.label() 
                   << " (" << input_data.start.x << ", " << input_data.start.y << ")\n";
-        std::cout << "End: " << input_data.end.label 
+        std::cout << "End: " << input_data.end.label() 
                   << " (" << input_data.end.x << ", " << input_data.end.y << ")\n\n";
         std::cout << "Gateway segments (in order):\n";
         for (const auto& segment : input_data.segments) 
         {
             std::cout << "  " << segment.order << ": " 
-                      << segment.left.label << " (" << segment.left.x << ", " << segment.left.y << ")"
+                      << segment.left.label() << " (" << segment.left.x << ", " << segment.left.y << ")"
                       << " -> " 
-                      << segment.right.label << " (" << segment.right.x << ", " << segment.right.y << ")\n";
+                      << segment.right.label() << " (" << segment.right.x << ", " << segment.right.y << ")\n";
         }
         std::cout << "\n";
+        // Gateways are projected once here; every visibility test from now on is planar.
+        std::unique_ptr<LocalProjection> projection;
+        if (geographic) 
+        {
+            projection.reset(new LocalProjection(LocalProjection::around(input_data.points)));
+            input_data.start = projection->project(input_data.start);
+            input_data.end = projection->project(input_data.end);
+            for (auto& segment : input_data.segments) 
+            {
+                segment.left = projection->project(segment.left);
+                segment.right = projection->project(segment.right);
+            }
+            std::cout << "Coordinates: geographic, projected about (" << projection->get_origin_lon() << ", " 
+                      << projection->get_origin_lat() << "); distances in great-circle metres\n";
+        }
         std::cout << "Building visibility graph and solving...\n";
         ShortestPathSolver solver;
+        solver.get_graph().set_projection(projection.get());
+        GeometryEngine& geometry = solver.get_graph().get_geometry_engine();
+        if (!configure_geometry(geometry, geometry_mode)) 
+        {
+            std::cerr << "Unknown geometry mode: " << geometry_mode << "\n";
+            return 1;
+        }
+        std::cout << "Intersection engine: " 
+                  << (geometry.get_intersection_backend() == IntersectionBackend::Geos ? "geos" : IntersectionKernel::simd_level_name(geometry.get_simd_level())) 
+                  << "\n";
+        geometry.set_spatial_index(spatial_index);
+        solver.get_graph().set_thread_count(thread_count);
+        std::cout << "Graph construction threads: " << solver.get_graph().get_thread_count() << "\n";
+        solver.set_lazy_graph(lazy_graph);
+        solver.get_graph().set_fused_constraints(!staged_constraints);
+        if (search_mode == "astar") 
+        {
+            solver.set_search_algorithm(SearchAlgorithm::AStar);
+        }
+        else if (search_mode == "corridor") 
+        {
+            solver.set_search_algorithm(SearchAlgorithm::AStarCorridor);
+        }
+        else if (search_mode == "layered") 
+        {
+            solver.set_search_algorithm(SearchAlgorithm::LayeredDag);
+        }
+        else if (search_mode == "continuous") 
+        {
+            solver.set_search_algorithm(SearchAlgorithm::ContinuousCrossing);
+        }
+        else if (search_mode == "windowed") 
+        {
+            solver.set_search_algorithm(SearchAlgorithm::Windowed);
+            solver.set_window(window_size, window_overlap);
+            std::cout << "Windows: " << window_size << " gateways, " << window_overlap << " shared\n";
+        }
+        else if (search_mode != "dijkstra") 
+        {
+            std::cerr << "Unknown search algorithm: " << search_mode << "\n";
+            return 1;
+        }
+        std::cout << "Search algorithm: " << search_mode << "\n";
         auto solve_start = std::chrono::high_resolution_clock::now();
-        PathResult result = solver.solve(input_data.segments, input_data.start, input_data.end);
+        std::vector<PathResult> routes;
+        PathResult result;
+        if (alternatives > 0) 
+        {
+            routes = solver.solve_alternatives(input_data.segments, input_data.start, input_data.end, alternatives);
+            if (!routes.empty()) 
+            {
+                result = routes.front();
+            }
+        }
+        else 
+        {
+            result = chart ? solver.solve(input_data.segments, input_data.start, input_data.end, *chart) 
+                           : solver.solve(input_data.segments, input_data.start, input_data.end);
+        }
         auto solve_end = std::chrono::high_resolution_clock::now();
         auto solve_duration = std::chrono::duration_cast<std::chrono::milliseconds>(solve_end - solve_start);
-        std::cout << "Solving completed in " << solve_duration.count() << " ms\n\n";
-        print_path_info(result);
+        std::cout << "Solving completed in " << solve_duration.count() << " ms\n";
+        std::cout << "Node pairs evaluated: " << solver.get_graph().get_pairs_evaluated() 
+                  << " of " << solver.get_graph().get_eager_pair_count() 
+                  << (solver.get_graph().is_lazy() ? " (lazy)" : solver.get_graph().is_attached() ? " (precomputed)" : " (eager)") << "\n";
+        std::cout << "Nodes settled: " << result.nodes_settled << "\n";
+        if (solver.get_search_algorithm() == SearchAlgorithm::Windowed && solver.get_windowed_solver()) 
+        {
+            const WindowedSolver& windowed = *solver.get_windowed_solver();
+            std::cout << "Windows solved: " << windowed.get_window_count() << ", error bound " << windowed.get_error_bound() 
+                      << (windowed.get_error_bound() == 0.0 ? " (exact)" : "") << "\n";
+        }
+        if (solver.get_search_algorithm() == SearchAlgorithm::ContinuousCrossing && result.found) 
+        {
+            // Cross-check against the endpoint-only visibility graph on the same input.
+            ShortestPathSolver reference;
+            configure_geometry(reference.get_graph().get_geometry_engine(), geometry_mode);
+            reference.get_graph().set_thread_count(thread_count);
+            PathResult endpoint_result = reference.solve(input_data.segments, input_data.start, input_data.end);
+            if (endpoint_result.found) 
+            {
+                std::cout << "Endpoint-graph distance: " << endpoint_result.total_distance 
+                          << " (continuous - endpoint = " << result.total_distance - endpoint_result.total_distance << ")\n";
+            }
+            else 
+            {
+                std::cout << "Endpoint-graph distance: no route\n";
+            }
+        }
+        std::cout << "\n";
+        print_path_info(result, projection.get());
+        for (size_t i = 1; i < routes.size(); ++i) 
+        {
+            std::cout << "Alternative " << i << ": distance " << routes[i].total_distance 
+                      << " (+" << routes[i].total_distance - result.total_distance << "), " << routes[i].path.size() << " points:";
+            for (const auto& point : routes[i].path) 
+            {
+                std::cout << " " << point.label();
+            }
+            std::cout << "\n";
+        }
         if (result.found) 
         {
             std::cout << "\nValidating path...\n";
-            bool is_valid = solver.validate_path(result.path, input_data.segments, input_data.start, input_data.end);
+            // Alternatives come from the endpoint graph whatever the search mode, so only a continuous
+            // solve is held to the continuous-mode rules.
+            bool continuous = solver.get_search_algorithm() == SearchAlgorithm::ContinuousCrossing && alternatives == 0;
+            bool is_valid = continuous ? solver.validate_crossings(result.path, input_data.segments, input_data.start, input_data.end) 
+                                       : solver.validate_path(result.path, input_data.segments, input_data.start, input_data.end);
             std::cout << "Path validation: " << (is_valid ? "PASSED" : "FAILED") << "\n";
             if (!is_valid) 
             {
-                std::cerr << "Warning: The computed path does not satisfy all constraints!\n";
+                // A route that breaks its mode's constraints is not written out; the metrics still are.
+                std::cerr << "Error: The computed path does not satisfy the " << (continuous ? "continuous-mode" : "gateway") << " constraints; nothing exported.\n";
+                write_metrics(stats_file, trace_file);
+                return 1;
             }
         }
         if (result.found) 
         {
             std::cout << "\nExporting result to: " << output_file << "\n";
-            JsonParser::export_path_to_file(result.path, result.total_distance, output_file);
+            // Geographic routes are written back in longitude/latitude.
+            auto output_path = [&projection](const std::vector<Point>& path) 
+            {
+                std::vector<Point> points;
+                points.reserve(path.size());
+                for (const auto& point : path) 
+                {
+                    points.push_back(projection ? projection->unproject(point) : point);
+                }
+                return points;
+            };
+            if (alternatives > 0) 
+            {
+                std::vector<std::vector<Point>> paths;
+                std::vector<double> distances;
+                for (const auto& route : routes) 
+                {
+                    paths.push_back(output_path(route.path));
+                    distances.push_back(route.total_distance);
+                }
+                JsonParser::export_routes_to_file(paths, distances, output_file);
+            }
+            else 
+            {
+                JsonParser::export_path_to_file(output_path(result.path), result.total_distance, output_file);
+            }
+        }
+        if (!chart_file.empty()) 
+        {
+            // Reuse the graph this run built when it is a complete eager one; otherwise build it now.
+            const VisibilityGraph* graph = &solver.get_graph();
+            VisibilityGraph chart_graph;
+            if (graph->is_lazy() || graph->get_node_count() != 2 * input_data.segments.size() + 2) 
+            {
+                configure_geometry(chart_graph.get_geometry_engine(), geometry_mode);
+                chart_graph.get_geometry_engine().set_spatial_index(spatial_index);
+                chart_graph.set_thread_count(thread_count);
+                chart_graph.build_graph(input_data.segments, input_data.start, input_data.end);
+                graph = &chart_graph;
+            }
+            JsonParser::export_chart_file(input_data, chart_file, graph);
+            std::cout << "\nChart written to: " << chart_file << " (" << graph->get_edge_count() << " edges)\n";
         }
         auto end_time = std::chrono::high_resolution_clock::now();
         auto total_duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
         std::cout << "\nTotal execution time: " << total_duration.count() << " ms\n";
+        write_metrics(stats_file, trace_file);
         return result.found ? 0 : 1;
     } 
     catch (const std::exception& e) 
@@ -0,0 +1,112 @@
+#include "mapped_file.h"
+#include <stdexcept>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+namespace marine_nav
+{
+#ifdef _WIN32
+    MappedFile::MappedFile(const std::string& filename) : data_(nullptr), size_(0), file_handle_(INVALID_HANDLE_VALUE), mapping_handle_(nullptr)
+    {
+        file_handle_ = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file_handle_ == INVALID_HANDLE_VALUE)
+        {
+            throw std::runtime_error("Could not open file: " + filename);
+        }
+        LARGE_INTEGER file_size;
+        if (!GetFileSizeEx(file_handle_, &file_size))
+        {
+            close();
+            throw std::runtime_error("Could not read size of file: " + filename);
+        }
+        size_ = static_cast<size_t>(file_size.QuadPart);
+        if (size_ == 0)
+        {
+            return;
+        }
+        mapping_handle_ = CreateFileMappingA(file_handle_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping_handle_ != nullptr)
+        {
+            data_ = static_cast<const char*>(MapViewOfFile(mapping_handle_, FILE_MAP_READ, 0, 0, 0));
+        }
+        if (data_ == nullptr)
+        {
+            close();
+            throw std::runtime_error("Could not map file: " + filename);
+        }
+    }
+
+    void MappedFile::close()
+    {
+        if (data_ != nullptr)
+        {
+            UnmapViewOfFile(data_);
+        }
+        if (mapping_handle_ != nullptr)
+        {
+            CloseHandle(mapping_handle_);
+        }
+        if (file_handle_ != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file_handle_);
+        }
+        data_ = nullptr;
+        mapping_handle_ = nullptr;
+        file_handle_ = INVALID_HANDLE_VALUE;
+    }
+#else
+    MappedFile::MappedFile(const std::string& filename) : data_(nullptr), size_(0)
+    {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0)
+        {
+            throw std::runtime_error("Could not open file: " + filename);
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            throw std::runtime_error("Could not read size of file: " + filename);
+        }
+        size_ = static_cast<size_t>(info.st_size);
+        if (size_ == 0)
+        {
+            ::close(fd);
+            return;
+        }
+        void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED)
+        {
+            size_ = 0;
+            throw std::runtime_error("Could not map file: " + filename);
+        }
+        // The parser makes a single forward pass, so let the kernel read ahead aggressively.
+        madvise(mapping, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char*>(mapping);
+    }
+
+    void MappedFile::close()
+    {
+        if (data_ != nullptr)
+        {
+            munmap(const_cast<char*>(data_), size_);
+        }
+        data_ = nullptr;
+        size_ = 0;
+    }
+#endif
+
+    MappedFile::~MappedFile()
+    {
+        close();
+    }
+}
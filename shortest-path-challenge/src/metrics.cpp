@@ -0,0 +1,214 @@
+#include "metrics.h"
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+#include <nlohmann/json.hpp>
+using json = nlohmann::json;
+namespace marine_nav
+{
+    namespace
+    {
+        struct PhaseTotal
+        {
+            uint64_t count = 0;
+            double total_us = 0.0;
+        };
+
+        struct TraceEvent
+        {
+            const char* name;
+            double begin_us;
+            double duration_us;
+            int thread;
+        };
+
+        // Function-local so that thread_local blocks created during static initialisation still find it.
+        struct Registry
+        {
+            std::mutex mutex;
+            std::unordered_set<CounterBlock*> blocks;
+            uint64_t retired[kCounterCount] = {};
+            std::map<std::string, PhaseTotal> phases;
+            std::vector<TraceEvent> trace;
+            std::atomic<bool> tracing{false};
+            std::atomic<int> next_thread{0};
+            const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+        };
+
+        Registry& registry()
+        {
+            static Registry instance;
+            return instance;
+        }
+
+        int trace_thread_id()
+        {
+            thread_local int id = registry().next_thread.fetch_add(1);
+            return id;
+        }
+
+        const char* const kCounterNames[kCounterCount] = {
+            "can_connect_calls",
+            "rejected_ordering",
+            "rejected_orientation",
+            "rejected_visibility",
+            "geos_intersects",
+            "exact_orientations",
+            "geodesic_weights",
+            "heap_pushes",
+            "heap_pops",
+            "stale_pops"
+        };
+    }
+
+    CounterBlock::CounterBlock()
+    {
+        for (auto& value : values)
+        {
+            value.store(0, std::memory_order_relaxed);
+        }
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        reg.blocks.insert(this);
+    }
+
+    CounterBlock::~CounterBlock()
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (size_t i = 0; i < kCounterCount; ++i)
+        {
+            reg.retired[i] += values[i].load(std::memory_order_relaxed);
+        }
+        reg.blocks.erase(this);
+    }
+
+    uint64_t Metrics::get(Counter counter)
+    {
+        size_t index = static_cast<size_t>(counter);
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        uint64_t total = reg.retired[index];
+        for (CounterBlock* block : reg.blocks)
+        {
+            total += block->values[index].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    void Metrics::reset()
+    {
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (size_t i = 0; i < kCounterCount; ++i)
+        {
+            reg.retired[i] = 0;
+        }
+        for (CounterBlock* block : reg.blocks)
+        {
+            for (auto& value : block->values)
+            {
+                value.store(0, std::memory_order_relaxed);
+            }
+        }
+        reg.phases.clear();
+        reg.trace.clear();
+    }
+
+    const char* Metrics::counter_name(Counter counter)
+    {
+        size_t index = static_cast<size_t>(counter);
+        return index < kCounterCount ? kCounterNames[index] : "unknown";
+    }
+
+    double Metrics::now_us()
+    {
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - registry().origin).count();
+    }
+
+    void Metrics::record_phase(const char* name, double begin_us, double end_us)
+    {
+        Registry& reg = registry();
+        int thread = reg.tracing.load(std::memory_order_relaxed) ? trace_thread_id() : 0;
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        PhaseTotal& total = reg.phases[name];
+        ++total.count;
+        total.total_us += end_us - begin_us;
+        if (reg.tracing.load(std::memory_order_relaxed))
+        {
+            reg.trace.push_back(TraceEvent{name, begin_us, end_us - begin_us, thread});
+        }
+    }
+
+    void Metrics::set_tracing(bool enabled)
+    {
+        registry().tracing.store(enabled);
+    }
+
+    bool Metrics::is_tracing()
+    {
+        return registry().tracing.load();
+    }
+
+    std::string Metrics::stats_json()
+    {
+        json stats;
+        stats["metrics_enabled"] = is_enabled();
+        stats["counters"] = json::object();
+        for (size_t i = 0; i < kCounterCount; ++i)
+        {
+            stats["counters"][kCounterNames[i]] = get(static_cast<Counter>(i));
+        }
+        stats["phases"] = json::object();
+        Registry& reg = registry();
+        std::lock_guard<std::mutex> lock(reg.mutex);
+        for (const auto& phase : reg.phases)
+        {
+            stats["phases"][phase.first] = {{"count", phase.second.count}, {"total_ms", phase.second.total_us / 1000.0}};
+        }
+        return stats.dump(2);
+    }
+
+    void Metrics::write_stats(const std::string& filename)
+    {
+        std::ofstream file(filename);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Could not create stats file: " + filename);
+        }
+        file << stats_json() << "\n";
+    }
+
+    void Metrics::write_trace(const std::string& filename)
+    {
+        json counters = json::object();
+        for (size_t i = 0; i < kCounterCount; ++i)
+        {
+            counters[kCounterNames[i]] = get(static_cast<Counter>(i));
+        }
+        double end_us = now_us();
+        json events = json::array();
+        {
+            Registry& reg = registry();
+            std::lock_guard<std::mutex> lock(reg.mutex);
+            for (const auto& event : reg.trace)
+            {
+                events.push_back({{"name", event.name}, {"cat", "marine_nav"}, {"ph", "X"}, {"ts", event.begin_us},
+                                  {"dur", event.duration_us}, {"pid", 1}, {"tid", event.thread}});
+            }
+        }
+        events.push_back({{"name", "counters"}, {"cat", "marine_nav"}, {"ph", "C"}, {"ts", end_us}, {"pid", 1}, {"tid", 0}, {"args", counters}});
+        json trace;
+        trace["traceEvents"] = events;
+        trace["displayTimeUnit"] = "ms";
+        std::ofstream file(filename);
+        if (!file.is_open())
+        {
+            throw std::runtime_error("Could not create trace file: " + filename);
+        }
+        file << trace.dump() << "\n";
+    }
+}
@@ -0,0 +1,166 @@
+#include "path_validator.h"
+#include "metrics.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+namespace marine_nav
+{
+    PathValidator::PathValidator()
+        : simd_level_(IntersectionKernel::detect_simd_level()), thread_count_(1) {}
+
+    void PathValidator::set_thread_count(size_t thread_count)
+    {
+        thread_count = ThreadPool::resolve_thread_count(thread_count);
+        if (thread_count != thread_count_)
+        {
+            thread_pool_.reset();
+        }
+        thread_count_ = thread_count;
+    }
+
+    void PathValidator::prepare(const std::vector<Segment>& segments)
+    {
+        arrays_.assign(segments);
+        by_order_.resize(segments.size());
+        for (size_t i = 0; i < segments.size(); ++i)
+        {
+            by_order_[i] = i;
+        }
+        std::stable_sort(by_order_.begin(), by_order_.end(), [&](size_t a, size_t b)
+        {
+            return segments[a].order < segments[b].order;
+        });
+        // Crossing labels that were never handed out cannot appear in a path, so only existing ones map.
+        std::vector<uint32_t> crossing_labels(segments.size());
+        uint32_t max_label = 0;
+        for (size_t i = 0; i < segments.size(); ++i)
+        {
+            const Segment& segment = segments[i];
+            crossing_labels[i] = LabelTable::global().find_crossing(segment.order);
+            max_label = std::max({max_label, segment.left.label_id, segment.right.label_id});
+            if (crossing_labels[i] != LabelTable::kNotFound)
+            {
+                max_label = std::max(max_label, crossing_labels[i]);
+            }
+        }
+        label_order_.assign(segments.empty() ? 0 : size_t(max_label) + 1, kNoOrder);
+        // A label shared by several segments belongs to the first one, as in the visibility graph.
+        for (size_t i = 0; i < segments.size(); ++i)
+        {
+            const Segment& segment = segments[i];
+            for (uint32_t label : {segment.left.label_id, segment.right.label_id, crossing_labels[i]})
+            {
+                if (label != LabelTable::kNotFound && label_order_[label] == kNoOrder)
+                {
+                    label_order_[label] = segment.order;
+                }
+            }
+        }
+    }
+
+    bool PathValidator::validate(const std::vector<Point>& path) const
+    {
+        if (path.empty())
+        {
+            return false;
+        }
+        int previous_order = -1;
+        for (size_t i = 1; i < path.size(); ++i)
+        {
+            int order = i + 1 == path.size() ? INT_MAX : order_of(path[i].label_id);
+            if (order == kNoOrder)
+            {
+                order = previous_order;
+            }
+            if (order < previous_order)
+            {
+                return false;
+            }
+            const Point& from = path[i - 1];
+            const Point& to = path[i];
+            if (IntersectionKernel::any_violation(arrays_, 0, arrays_.size(), from.x, from.y, to.x, to.y, order, simd_level_))
+            {
+                return false;
+            }
+            previous_order = order;
+        }
+        return true;
+    }
+
+    bool PathValidator::validate(const std::vector<Point>& path, const Point& start, const Point& end) const
+    {
+        if (path.empty() || path.front().label_id != start.label_id || path.back().label_id != end.label_id)
+        {
+            return false;
+        }
+        return validate(path);
+    }
+
+    bool PathValidator::validate_crossings(const std::vector<Point>& path, const Point& start, const Point& end) const
+    {
+        size_t count = arrays_.size();
+        if (path.size() != count + 2 || path.front().label_id != start.label_id || path.back().label_id != end.label_id)
+        {
+            return false;
+        }
+        for (size_t i = 1; i <= count; ++i)
+        {
+            size_t gateway = by_order_[i - 1];
+            double left_x = arrays_.left_x[gateway];
+            double left_y = arrays_.left_y[gateway];
+            double right_x = arrays_.right_x[gateway];
+            double right_y = arrays_.right_y[gateway];
+            const Point& at = path[i];
+            // On the gateway, up to the rounding of the computed crossing.
+            double dx = right_x - left_x;
+            double dy = right_y - left_y;
+            double length = std::sqrt(dx * dx + dy * dy);
+            double slack = 1e-9 * std::max(1.0, length);
+            double along = length > 0.0 ? ((at.x - left_x) * dx + (at.y - left_y) * dy) / length : 0.0;
+            if (std::fabs(IntersectionKernel::orientation(left_x, left_y, right_x, right_y, at.x, at.y)) > slack * length
+                || along < -slack || along > length + slack)
+            {
+                return false;
+            }
+            // The legs into and out of the crossing both pass the gateway left end to port; a crossing on
+            // an end is collinear with that end only.
+            const Point* legs[2][2] = {{&path[i - 1], &at}, {&at, &path[i + 1]}};
+            for (const auto& leg : legs)
+            {
+                double cross_left = IntersectionKernel::orientation(leg[0]->x, leg[0]->y, leg[1]->x, leg[1]->y, left_x, left_y);
+                double cross_right = IntersectionKernel::orientation(leg[0]->x, leg[0]->y, leg[1]->x, leg[1]->y, right_x, right_y);
+                if (cross_left < 0 || cross_right > 0 || (cross_left == 0 && cross_right == 0))
+                {
+                    return false;
+                }
+            }
+        }
+        for (size_t i = 0; i + 1 < path.size(); ++i)
+        {
+            int order = i < count ? arrays_.order[by_order_[i]] : INT_MAX;
+            if (IntersectionKernel::any_intersection(arrays_, 0, count, path[i].x, path[i].y, path[i + 1].x, path[i + 1].y, order, simd_level_))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> PathValidator::validate_batch(const std::vector<std::vector<Point>>& paths)
+    {
+        MARINE_NAV_PHASE("validate_batch");
+        std::vector<uint8_t> results(paths.size(), 0);
+        if (!thread_pool_)
+        {
+            thread_pool_ = std::make_unique<ThreadPool>(thread_count_);
+        }
+        thread_pool_->parallel_for(paths.size(), 16, [&](size_t begin, size_t end, size_t)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                results[i] = validate(paths[i]) ? 1 : 0;
+            }
+        });
+        return results;
+    }
+}
@@ -0,0 +1,384 @@
+#include "route_service.h"
+#include "graph_search.h"
+#include "metrics.h"
+#include <algorithm>
+#include <climits>
+namespace marine_nav
+{
+    RouteService::RouteService() : thread_count_(1), loaded_(false) {}
+
+    void RouteService::set_thread_count(size_t thread_count)
+    {
+        thread_count = ThreadPool::resolve_thread_count(thread_count);
+        if (thread_count != thread_count_)
+        {
+            thread_pool_.reset();
+        }
+        thread_count_ = thread_count;
+        graph_.set_thread_count(thread_count);
+    }
+
+    void RouteService::load(const std::vector<Segment>& segments)
+    {
+        segments_ = segments;
+        graph_.build_gateway_graph(segments_);
+        // Gateway nodes grouped by gateway order, so queries can attach layer by layer.
+        int gateway_count = static_cast<int>(graph_.get_node_count());
+        layer_nodes_.resize(gateway_count);
+        for (int v = 0; v < gateway_count; ++v)
+        {
+            layer_nodes_[v] = v;
+        }
+        std::stable_sort(layer_nodes_.begin(), layer_nodes_.end(), [&](int a, int b)
+        {
+            return graph_.get_node(a).segment_order < graph_.get_node(b).segment_order;
+        });
+        layer_offsets_.assign(1, 0);
+        for (int k = 1; k <= gateway_count; ++k)
+        {
+            if (k == gateway_count || graph_.get_node(layer_nodes_[k]).segment_order != graph_.get_node(layer_nodes_[k - 1]).segment_order)
+            {
+                layer_offsets_.push_back(k);
+            }
+        }
+        oracle_.clear();
+        loaded_ = true;
+    }
+
+    void RouteService::build_oracle()
+    {
+        oracle_.build(graph_, segments_, thread_count_);
+    }
+
+    void RouteService::load_oracle(const std::string& filename)
+    {
+        oracle_.load(filename, segments_);
+    }
+
+    double RouteService::route_distance(const Point& start, const Point& end) const
+    {
+        MARINE_NAV_PHASE("route_distance");
+        const double infinity = std::numeric_limits<double>::infinity();
+        const GeometryEngine& engine = graph_.get_geometry_engine();
+        GraphNode start_node(start, -1, false);
+        GraphNode end_node(end, INT_MAX, false);
+        double best = graph_.can_connect(start_node, end_node, engine) ? engine.calculate_distance(start, end) : infinity;
+        thread_local std::vector<std::pair<int, double>> start_edges;
+        thread_local std::vector<std::pair<int, double>> end_edges;
+        thread_local std::vector<char> scanned;
+        start_edges.clear();
+        end_edges.clear();
+        scanned.assign(graph_.get_node_count() * 2, 0);
+        size_t layer_count = layer_offsets_.size() - 1;
+        // A leg through node v costs at least the straight line start-v-end, so nodes that cannot beat
+        // best are never tested. A leg ending on a gateway node is checked against that gateway first;
+        // the rest of the check is is_visible, whose crossing test runs on the STR segment index.
+        auto attach = [&](int v, bool to_end)
+        {
+            const GraphNode& node = graph_.get_node(v);
+            double to_start = engine.calculate_distance(start, node.point);
+            double to_goal = engine.calculate_distance(node.point, end);
+            if (to_start + to_goal >= best || scanned[2 * v + to_end])
+            {
+                return false;
+            }
+            scanned[2 * v + to_end] = 1;
+            const GraphNode& from = to_end ? node : start_node;
+            const GraphNode& to = to_end ? end_node : node;
+            if (VisibilityGraph::segment_blocks(from, to, segments_[v / 2])
+                || !engine.is_visible(from.point, to.point, segments_, std::max(from.segment_order, to.segment_order)))
+            {
+                return false;
+            }
+            if (to_end)
+            {
+                end_edges.emplace_back(v, to_goal);
+            }
+            else
+            {
+                start_edges.emplace_back(v, to_start);
+            }
+            return true;
+        };
+        auto combine = [&]()
+        {
+            for (const auto& first : start_edges)
+            {
+                for (const auto& last : end_edges)
+                {
+                    double candidate = first.second + oracle_.distance(first.first, last.first) + last.second;
+                    if (candidate < best)
+                    {
+                        best = candidate;
+                    }
+                }
+            }
+        };
+        // Start attaches to the first layers in gateway order and end to the last ones; each scan stops
+        // at the first layer that reaches its endpoint.
+        bool reached = false;
+        for (size_t layer = 0; layer < layer_count && !reached; ++layer)
+        {
+            for (size_t k = layer_offsets_[layer]; k < layer_offsets_[layer + 1]; ++k)
+            {
+                reached |= attach(layer_nodes_[k], false);
+            }
+        }
+        reached = false;
+        for (size_t layer = layer_count; layer-- > 0 && !reached;)
+        {
+            for (size_t k = layer_offsets_[layer]; k < layer_offsets_[layer + 1]; ++k)
+            {
+                reached |= attach(layer_nodes_[k], true);
+            }
+        }
+        combine();
+        // A route may still leave start past its first reachable layer or reach end before the last
+        // one. Only nodes whose straight-line bound beats the best route found so far are tested, so
+        // the answer stays exact and this pass is usually empty.
+        size_t start_known = start_edges.size();
+        size_t end_known = end_edges.size();
+        for (int v : layer_nodes_)
+        {
+            attach(v, false);
+            attach(v, true);
+        }
+        if (start_edges.size() > start_known || end_edges.size() > end_known)
+        {
+            combine();
+        }
+        return best;
+    }
+
+    PathResult RouteService::route(const Point& start, const Point& end) const
+    {
+        // Callers outside the pool get one workspace per thread.
+        thread_local SolverWorkspace workspace;
+        return route(start, end, graph_.get_geometry_engine(), workspace);
+    }
+
+    PathResult RouteService::route(const Point& start, const Point& end, const GeometryEngine& engine, SolverWorkspace& workspace) const
+    {
+        // Gateway nodes keep their graph indices; start and end are appended as the two last nodes,
+        // and only pairs that involve them are evaluated here.
+        PathResult result;
+        const double infinity = std::numeric_limits<double>::infinity();
+        int gateway_count = static_cast<int>(graph_.get_node_count());
+        int start_idx = gateway_count;
+        int end_idx = gateway_count + 1;
+        GraphNode start_node(start, -1, false);
+        GraphNode end_node(end, INT_MAX, false);
+        thread_local std::vector<std::pair<int, double>> start_edges;
+        thread_local std::vector<double> to_end;
+        start_edges.clear();
+        to_end.assign(gateway_count, infinity);
+        for (int v = 0; v < gateway_count; ++v)
+        {
+            const GraphNode& node = graph_.get_node(v);
+            if (graph_.can_connect(start_node, node, engine))
+            {
+                start_edges.emplace_back(v, engine.calculate_distance(start, node.point));
+            }
+            if (graph_.can_connect(node, end_node, engine))
+            {
+                to_end[v] = engine.calculate_distance(node.point, end);
+            }
+        }
+        if (graph_.can_connect(start_node, end_node, engine))
+        {
+            start_edges.emplace_back(end_idx, engine.calculate_distance(start, end));
+        }
+        result.nodes_settled = search_from(workspace, gateway_count + 2, start_idx, end_idx, [&](int u, const auto& relax)
+        {
+            if (u == start_idx)
+            {
+                for (const auto& edge : start_edges)
+                {
+                    relax(edge.first, edge.second);
+                }
+                return;
+            }
+            NeighborRange row = forward_part(graph_.get_row(u), u);
+            for (size_t k = 0; k < row.count; ++k)
+            {
+                relax(row.targets[k], row.weights[k]);
+            }
+            if (to_end[u] != infinity)
+            {
+                relax(end_idx, to_end[u]);
+            }
+        });
+        if (workspace.distance(end_idx) == infinity)
+        {
+            return result;
+        }
+        std::vector<int>& indices = workspace.order;
+        indices.clear();
+        for (int current = end_idx; current != -1; current = workspace.previous(current))
+        {
+            indices.push_back(current);
+        }
+        std::reverse(indices.begin(), indices.end());
+        result.path.reserve(indices.size());
+        for (int idx : indices)
+        {
+            result.path.push_back(idx == start_idx ? start : (idx == end_idx ? end : graph_.get_node(idx).point));
+        }
+        result.total_distance = workspace.distance(end_idx);
+        result.found = true;
+        return result;
+    }
+
+    std::vector<PathResult> RouteService::route_batch(const std::vector<std::pair<Point, Point>>& queries)
+    {
+        std::vector<PathResult> results(queries.size());
+        if (!thread_pool_)
+        {
+            thread_pool_ = std::make_unique<ThreadPool>(thread_count_);
+        }
+        while (workspaces_.size() < thread_pool_->size())
+        {
+            workspaces_.push_back(std::make_unique<SolverWorkspace>());
+        }
+        const GeometryEngine& engine = graph_.get_geometry_engine();
+        thread_pool_->parallel_for(queries.size(), 1, [&](size_t begin, size_t end, size_t worker)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                results[i] = route(queries[i].first, queries[i].second, engine, *workspaces_[worker]);
+            }
+        });
+        return results;
+    }
+
+    std::vector<double> RouteService::route_distance_batch(const std::vector<std::pair<Point, Point>>& queries)
+    {
+        std::vector<double> results(queries.size());
+        if (!thread_pool_)
+        {
+            thread_pool_ = std::make_unique<ThreadPool>(thread_count_);
+        }
+        thread_pool_->parallel_for(queries.size(), 16, [&](size_t begin, size_t end, size_t)
+        {
+            for (size_t i = begin; i < end; ++i)
+            {
+                results[i] = route_distance(queries[i].first, queries[i].second);
+            }
+        });
+        return results;
+    }
+
+    RouteMatrix RouteService::route_matrix(const std::vector<Point>& starts, const std::vector<Point>& ends, bool with_paths)
+    {
+        MARINE_NAV_PHASE("route_matrix");
+        const double infinity = std::numeric_limits<double>::infinity();
+        const GeometryEngine& engine = graph_.get_geometry_engine();
+        int gateway_count = static_cast<int>(graph_.get_node_count());
+        int start_idx = gateway_count;
+        RouteMatrix matrix;
+        matrix.rows = starts.size();
+        matrix.cols = ends.size();
+        matrix.costs.assign(matrix.rows * matrix.cols, infinity);
+        if (with_paths)
+        {
+            matrix.paths.assign(matrix.rows * matrix.cols, PathResult());
+        }
+        if (!thread_pool_)
+        {
+            thread_pool_ = std::make_unique<ThreadPool>(thread_count_);
+        }
+        while (workspaces_.size() < thread_pool_->size())
+        {
+            workspaces_.push_back(std::make_unique<SolverWorkspace>());
+        }
+        // Gateway nodes that may finish at each end, with the closing leg's length.
+        std::vector<std::vector<std::pair<int, double>>> end_edges(ends.size());
+        thread_pool_->parallel_for(ends.size(), 1, [&](size_t begin, size_t end, size_t)
+        {
+            for (size_t j = begin; j < end; ++j)
+            {
+                GraphNode end_node(ends[j], INT_MAX, false);
+                for (int v = 0; v < gateway_count; ++v)
+                {
+                    const GraphNode& node = graph_.get_node(v);
+                    if (graph_.can_connect(node, end_node, engine))
+                    {
+                        end_edges[j].emplace_back(v, engine.calculate_distance(node.point, ends[j]));
+                    }
+                }
+            }
+        });
+        thread_pool_->parallel_for(starts.size(), 1, [&](size_t begin, size_t end, size_t worker)
+        {
+            SolverWorkspace& workspace = *workspaces_[worker];
+            std::vector<std::pair<int, double>> start_edges;
+            for (size_t i = begin; i < end; ++i)
+            {
+                const Point& start = starts[i];
+                GraphNode start_node(start, -1, false);
+                start_edges.clear();
+                for (int v = 0; v < gateway_count; ++v)
+                {
+                    const GraphNode& node = graph_.get_node(v);
+                    if (graph_.can_connect(start_node, node, engine))
+                    {
+                        start_edges.emplace_back(v, engine.calculate_distance(start, node.point));
+                    }
+                }
+                // Every end is reached through its closing leg, so the search runs to exhaustion
+                // instead of stopping at one end.
+                size_t nodes_settled = search_from(workspace, gateway_count + 1, start_idx, -1, [&](int u, const auto& relax)
+                {
+                    if (u == start_idx)
+                    {
+                        for (const auto& edge : start_edges)
+                        {
+                            relax(edge.first, edge.second);
+                        }
+                        return;
+                    }
+                    NeighborRange row = forward_part(graph_.get_row(u), u);
+                    for (size_t k = 0; k < row.count; ++k)
+                    {
+                        relax(row.targets[k], row.weights[k]);
+                    }
+                });
+                for (size_t j = 0; j < ends.size(); ++j)
+                {
+                    double best = infinity;
+                    int via = -1;
+                    if (graph_.can_connect(start_node, GraphNode(ends[j], INT_MAX, false), engine))
+                    {
+                        best = engine.calculate_distance(start, ends[j]);
+                        via = start_idx;
+                    }
+                    for (const auto& edge : end_edges[j])
+                    {
+                        double candidate = workspace.distance(edge.first) + edge.second;
+                        if (candidate < best)
+                        {
+                            best = candidate;
+                            via = edge.first;
+                        }
+                    }
+                    matrix.costs[i * matrix.cols + j] = best;
+                    if (!with_paths || via == -1)
+                    {
+                        continue;
+                    }
+                    PathResult& result = matrix.paths[i * matrix.cols + j];
+                    result.path.push_back(ends[j]);
+                    for (int node = via; node != -1; node = workspace.previous(node))
+                    {
+                        result.path.push_back(node == start_idx ? start : graph_.get_node(node).point);
+                    }
+                    std::reverse(result.path.begin(), result.path.end());
+                    result.total_distance = best;
+                    result.found = true;
+                    result.nodes_settled = nodes_settled;
+                }
+            }
+        });
+        return matrix;
+    }
+}
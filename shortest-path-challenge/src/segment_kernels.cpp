@@ -0,0 +1,545 @@
+#include "segment_kernels.h"
+#include "geometry.h"
+#include "metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MARINE_NAV_X86_SIMD 1
+#include <immintrin.h>
+#endif
+namespace marine_nav
+{
+    namespace
+    {
+        // Error-free transformations: a + b == sum + error and a * b == product + error, exactly.
+        void two_sum(double a, double b, double& sum, double& error)
+        {
+            double s = a + b;
+            double b_virtual = s - a;
+            double a_virtual = s - b_virtual;
+            error = (a - a_virtual) + (b - b_virtual);
+            sum = s;
+        }
+
+        void two_product(double a, double b, double& product, double& error)
+        {
+            double p = a * b;
+            error = std::fma(a, b, -p);
+            product = p;
+        }
+
+        // Grow-Expansion: adds q to a nonoverlapping expansion ordered by increasing magnitude, keeping
+        // both properties, so the last nonzero component always has the sign of the whole sum.
+        void grow_expansion(double* expansion, size_t& length, double q)
+        {
+            for (size_t i = 0; i < length; ++i)
+            {
+                two_sum(q, expansion[i], q, expansion[i]);
+            }
+            expansion[length++] = q;
+        }
+
+        double expansion_sign_component(const double* expansion, size_t length)
+        {
+            while (length > 0)
+            {
+                if (expansion[--length] != 0.0)
+                {
+                    return expansion[length];
+                }
+            }
+            return 0.0;
+        }
+    }
+
+    void SegmentArrays::assign(const std::vector<Segment>& segments)
+    {
+        clear();
+        left_x.reserve(segments.size());
+        left_y.reserve(segments.size());
+        right_x.reserve(segments.size());
+        right_y.reserve(segments.size());
+        order.reserve(segments.size());
+        for (const auto& segment : segments)
+        {
+            min_x = std::min({min_x, segment.left.x, segment.right.x});
+            min_y = std::min({min_y, segment.left.y, segment.right.y});
+            max_x = std::max({max_x, segment.left.x, segment.right.x});
+            max_y = std::max({max_y, segment.left.y, segment.right.y});
+            left_x.push_back(segment.left.x);
+            left_y.push_back(segment.left.y);
+            right_x.push_back(segment.right.x);
+            right_y.push_back(segment.right.y);
+            order.push_back(segment.order);
+        }
+    }
+
+    void SegmentArrays::clear()
+    {
+        left_x.clear();
+        left_y.clear();
+        right_x.clear();
+        right_y.clear();
+        order.clear();
+        min_x = std::numeric_limits<double>::infinity();
+        min_y = std::numeric_limits<double>::infinity();
+        max_x = -std::numeric_limits<double>::infinity();
+        max_y = -std::numeric_limits<double>::infinity();
+    }
+
+    SimdLevel IntersectionKernel::detect_simd_level()
+    {
+#ifdef MARINE_NAV_X86_SIMD
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return SimdLevel::AVX2;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return SimdLevel::SSE2;
+        }
+#endif
+        return SimdLevel::Scalar;
+    }
+
+    const char* IntersectionKernel::simd_level_name(SimdLevel level)
+    {
+        switch (level)
+        {
+            case SimdLevel::AVX2:
+                return "avx2";
+            case SimdLevel::SSE2:
+                return "sse2";
+            default:
+                return "scalar";
+        }
+    }
+
+    double IntersectionKernel::orientation_exact(double ax, double ay, double bx, double by, double cx, double cy)
+    {
+        MARINE_NAV_COUNT(ExactOrientations);
+        double expansion[12];
+        size_t length = 0;
+        double parts[2];
+        double abx, aby, acx, acy;
+        double tails[4];
+        two_sum(bx, -ax, abx, tails[0]);
+        two_sum(by, -ay, aby, tails[1]);
+        two_sum(cx, -ax, acx, tails[2]);
+        two_sum(cy, -ay, acy, tails[3]);
+        if (tails[0] == 0.0 && tails[1] == 0.0 && tails[2] == 0.0 && tails[3] == 0.0)
+        {
+            // The differences are exact (the usual case for nearby points), so two exact products suffice.
+            two_product(abx, acy, parts[1], parts[0]);
+            grow_expansion(expansion, length, parts[0]);
+            grow_expansion(expansion, length, parts[1]);
+            two_product(-aby, acx, parts[1], parts[0]);
+            grow_expansion(expansion, length, parts[0]);
+            grow_expansion(expansion, length, parts[1]);
+            return expansion_sign_component(expansion, length);
+        }
+        // (bx - ax)(cy - ay) - (by - ay)(cx - ax) multiplied out; the ax * ay terms cancel.
+        const double factors[6][2] = {{bx, cy}, {-bx, ay}, {-ax, cy}, {-by, cx}, {by, ax}, {ay, cx}};
+        for (const auto& factor : factors)
+        {
+            two_product(factor[0], factor[1], parts[1], parts[0]);
+            grow_expansion(expansion, length, parts[0]);
+            grow_expansion(expansion, length, parts[1]);
+        }
+        return expansion_sign_component(expansion, length);
+    }
+
+    bool IntersectionKernel::segments_intersect(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy)
+    {
+        // Orientation of each endpoint against the other segment's supporting line.
+        double d1 = orientation(cx, cy, dx, dy, ax, ay);
+        double d2 = orientation(cx, cy, dx, dy, bx, by);
+        double d3 = orientation(ax, ay, bx, by, cx, cy);
+        double d4 = orientation(ax, ay, bx, by, dx, dy);
+        bool straddles = (d1 <= 0 || d2 <= 0) && (d1 >= 0 || d2 >= 0) && (d3 <= 0 || d4 <= 0) && (d3 >= 0 || d4 >= 0);
+        if (!straddles)
+        {
+            return false;
+        }
+        // Bounding boxes only matter for the collinear case, but the test is cheap and keeps the kernels branch-free.
+        bool overlap_x = std::max(std::min(ax, bx), std::min(cx, dx)) <= std::min(std::max(ax, bx), std::max(cx, dx));
+        bool overlap_y = std::max(std::min(ay, by), std::min(cy, dy)) <= std::min(std::max(ay, by), std::max(cy, dy));
+        return overlap_x && overlap_y;
+    }
+
+    inline IntersectionKernel::LegBounds IntersectionKernel::leg_bounds(const SegmentArrays& arrays, double from_x, double from_y, double to_x, double to_y)
+    {
+        // Rounding is monotone, so each rounded coordinate difference a kernel forms is at most the rounded
+        // difference to the farthest box edge, and each product at most the product of those maxima. Both
+        // bounds therefore dominate orientation's per-product bound for every segment in the box.
+        double dx = std::max(std::max(std::fabs(arrays.min_x - from_x), std::fabs(arrays.max_x - from_x)), 
+                             std::max(std::fabs(arrays.min_x - to_x), std::fabs(arrays.max_x - to_x)));
+        double dy = std::max(std::max(std::fabs(arrays.min_y - from_y), std::fabs(arrays.max_y - from_y)), 
+                             std::max(std::fabs(arrays.min_y - to_y), std::fabs(arrays.max_y - to_y)));
+        LegBounds bounds;
+        bounds.leg = kOrientationErrorBound * (std::fabs(to_x - from_x) * dy + std::fabs(to_y - from_y) * dx);
+        bounds.segment = kOrientationErrorBound * ((arrays.max_x - arrays.min_x) * dy + (arrays.max_y - arrays.min_y) * dx);
+        return bounds;
+    }
+
+    ConstraintFailure IntersectionKernel::first_violation(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int max_order)
+    {
+        const double min_x = std::min(from_x, to_x);
+        const double max_x = std::max(from_x, to_x);
+        const double min_y = std::min(from_y, to_y);
+        const double max_y = std::max(from_y, to_y);
+        for (size_t i = begin; i < end; ++i)
+        {
+            const double lx = arrays.left_x[i];
+            const double ly = arrays.left_y[i];
+            const double rx = arrays.right_x[i];
+            const double ry = arrays.right_y[i];
+            if (orientation(from_x, from_y, to_x, to_y, lx, ly) <= 0 || orientation(from_x, from_y, to_x, to_y, rx, ry) >= 0)
+            {
+                return ConstraintFailure::Orientation;
+            }
+            if (arrays.order[i] <= max_order)
+            {
+                continue;
+            }
+            // The segment strictly straddles the line through from-to, so it can only be hit when the boxes overlap.
+            if (std::max(lx, rx) < min_x || std::min(lx, rx) > max_x || std::max(ly, ry) < min_y || std::min(ly, ry) > max_y)
+            {
+                continue;
+            }
+            if (segments_intersect(from_x, from_y, to_x, to_y, lx, ly, rx, ry))
+            {
+                return ConstraintFailure::Visibility;
+            }
+        }
+        return ConstraintFailure::None;
+    }
+
+    bool IntersectionKernel::any_violation(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int max_order, SimdLevel level)
+    {
+        switch (level)
+        {
+            case SimdLevel::AVX2:
+                return any_violation_avx2(arrays, begin, end, from_x, from_y, to_x, to_y, max_order);
+            case SimdLevel::SSE2:
+                return any_violation_sse2(arrays, begin, end, from_x, from_y, to_x, to_y, max_order);
+            default:
+                return first_violation(arrays, begin, end, from_x, from_y, to_x, to_y, max_order) != ConstraintFailure::None;
+        }
+    }
+
+    bool IntersectionKernel::any_intersection(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int min_order, SimdLevel level)
+    {
+        switch (level)
+        {
+            case SimdLevel::AVX2:
+                return any_intersection_avx2(arrays, begin, end, from_x, from_y, to_x, to_y, min_order);
+            case SimdLevel::SSE2:
+                return any_intersection_sse2(arrays, begin, end, from_x, from_y, to_x, to_y, min_order);
+            default:
+                return any_intersection_scalar(arrays, begin, end, from_x, from_y, to_x, to_y, min_order);
+        }
+    }
+
+    bool IntersectionKernel::any_intersection_scalar(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int min_order)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            if (arrays.order[i] <= min_order)
+            {
+                continue;
+            }
+            if (segments_intersect(from_x, from_y, to_x, to_y, arrays.left_x[i], arrays.left_y[i], arrays.right_x[i], arrays.right_y[i]))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+#ifdef MARINE_NAV_X86_SIMD
+    namespace
+    {
+        // Lanes whose rounded cross product is inside the leg's static error bound (see leg_bounds).
+        __attribute__((target("sse2")))
+        inline __m128d uncertain_sse2(__m128d d, __m128d bound)
+        {
+            return _mm_cmplt_pd(_mm_andnot_pd(_mm_set1_pd(-0.0), d), bound);
+        }
+
+        __attribute__((target("avx2")))
+        inline __m256d uncertain_avx2(__m256d d, __m256d bound)
+        {
+            return _mm256_cmp_pd(_mm256_andnot_pd(_mm256_set1_pd(-0.0), d), bound, _CMP_LT_OQ);
+        }
+    }
+
+    __attribute__((target("sse2")))
+    bool IntersectionKernel::any_intersection_sse2(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int min_order)
+    {
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d ax = _mm_set1_pd(from_x);
+        const __m128d ay = _mm_set1_pd(from_y);
+        const __m128d ex = _mm_set1_pd(to_x - from_x);
+        const __m128d ey = _mm_set1_pd(to_y - from_y);
+        const __m128d bx = _mm_set1_pd(to_x);
+        const __m128d by = _mm_set1_pd(to_y);
+        const __m128d min_ax = _mm_set1_pd(std::min(from_x, to_x));
+        const __m128d max_ax = _mm_set1_pd(std::max(from_x, to_x));
+        const __m128d min_ay = _mm_set1_pd(std::min(from_y, to_y));
+        const __m128d max_ay = _mm_set1_pd(std::max(from_y, to_y));
+        const LegBounds bounds = leg_bounds(arrays, from_x, from_y, to_x, to_y);
+        const __m128d leg_bound = _mm_set1_pd(bounds.leg);
+        const __m128d segment_bound = _mm_set1_pd(bounds.segment);
+        const __m128i order_floor = _mm_set1_epi32(min_order);
+        size_t i = begin;
+        for (; i + 2 <= end; i += 2)
+        {
+            __m128d cx = _mm_loadu_pd(&arrays.left_x[i]);
+            __m128d cy = _mm_loadu_pd(&arrays.left_y[i]);
+            __m128d dx = _mm_loadu_pd(&arrays.right_x[i]);
+            __m128d dy = _mm_loadu_pd(&arrays.right_y[i]);
+            __m128d sx = _mm_sub_pd(dx, cx);
+            __m128d sy = _mm_sub_pd(dy, cy);
+            __m128d d1 = _mm_sub_pd(_mm_mul_pd(sx, _mm_sub_pd(ay, cy)), _mm_mul_pd(sy, _mm_sub_pd(ax, cx)));
+            __m128d d2 = _mm_sub_pd(_mm_mul_pd(sx, _mm_sub_pd(by, cy)), _mm_mul_pd(sy, _mm_sub_pd(bx, cx)));
+            __m128d d3 = _mm_sub_pd(_mm_mul_pd(ex, _mm_sub_pd(cy, ay)), _mm_mul_pd(ey, _mm_sub_pd(cx, ax)));
+            __m128d d4 = _mm_sub_pd(_mm_mul_pd(ex, _mm_sub_pd(dy, ay)), _mm_mul_pd(ey, _mm_sub_pd(dx, ax)));
+            __m128d hit = _mm_and_pd(_mm_or_pd(_mm_cmple_pd(d1, zero), _mm_cmple_pd(d2, zero)), _mm_or_pd(_mm_cmpge_pd(d1, zero), _mm_cmpge_pd(d2, zero)));
+            hit = _mm_and_pd(hit, _mm_and_pd(_mm_or_pd(_mm_cmple_pd(d3, zero), _mm_cmple_pd(d4, zero)), _mm_or_pd(_mm_cmpge_pd(d3, zero), _mm_cmpge_pd(d4, zero))));
+            __m128d lo_x = _mm_max_pd(min_ax, _mm_min_pd(cx, dx));
+            __m128d hi_x = _mm_min_pd(max_ax, _mm_max_pd(cx, dx));
+            __m128d lo_y = _mm_max_pd(min_ay, _mm_min_pd(cy, dy));
+            __m128d hi_y = _mm_min_pd(max_ay, _mm_max_pd(cy, dy));
+            hit = _mm_and_pd(hit, _mm_and_pd(_mm_cmple_pd(lo_x, hi_x), _mm_cmple_pd(lo_y, hi_y)));
+            __m128i orders = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&arrays.order[i]));
+            __m128i eligible = _mm_cmpgt_epi32(orders, order_floor);
+            __m128d eligible_lanes = _mm_castsi128_pd(_mm_unpacklo_epi32(eligible, eligible));
+            __m128d uncertain = _mm_or_pd(_mm_or_pd(uncertain_sse2(d1, segment_bound), uncertain_sse2(d2, segment_bound)), 
+                                          _mm_or_pd(uncertain_sse2(d3, leg_bound), uncertain_sse2(d4, leg_bound)));
+            if (_mm_movemask_pd(_mm_and_pd(uncertain, eligible_lanes)) != 0)
+            {
+                // A near-collinear lane: this step is settled by the scalar kernel's exact predicates.
+                if (any_intersection_scalar(arrays, i, i + 2, from_x, from_y, to_x, to_y, min_order))
+                {
+                    return true;
+                }
+                continue;
+            }
+            hit = _mm_and_pd(hit, eligible_lanes);
+            if (_mm_movemask_pd(hit) != 0)
+            {
+                return true;
+            }
+        }
+        return any_intersection_scalar(arrays, i, end, from_x, from_y, to_x, to_y, min_order);
+    }
+
+    __attribute__((target("avx2")))
+    bool IntersectionKernel::any_intersection_avx2(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int min_order)
+    {
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256d ax = _mm256_set1_pd(from_x);
+        const __m256d ay = _mm256_set1_pd(from_y);
+        const __m256d ex = _mm256_set1_pd(to_x - from_x);
+        const __m256d ey = _mm256_set1_pd(to_y - from_y);
+        const __m256d bx = _mm256_set1_pd(to_x);
+        const __m256d by = _mm256_set1_pd(to_y);
+        const __m256d min_ax = _mm256_set1_pd(std::min(from_x, to_x));
+        const __m256d max_ax = _mm256_set1_pd(std::max(from_x, to_x));
+        const __m256d min_ay = _mm256_set1_pd(std::min(from_y, to_y));
+        const __m256d max_ay = _mm256_set1_pd(std::max(from_y, to_y));
+        const LegBounds bounds = leg_bounds(arrays, from_x, from_y, to_x, to_y);
+        const __m256d leg_bound = _mm256_set1_pd(bounds.leg);
+        const __m256d segment_bound = _mm256_set1_pd(bounds.segment);
+        const __m128i order_floor = _mm_set1_epi32(min_order);
+        size_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            __m256d cx = _mm256_loadu_pd(&arrays.left_x[i]);
+            __m256d cy = _mm256_loadu_pd(&arrays.left_y[i]);
+            __m256d dx = _mm256_loadu_pd(&arrays.right_x[i]);
+            __m256d dy = _mm256_loadu_pd(&arrays.right_y[i]);
+            __m256d sx = _mm256_sub_pd(dx, cx);
+            __m256d sy = _mm256_sub_pd(dy, cy);
+            __m256d d1 = _mm256_sub_pd(_mm256_mul_pd(sx, _mm256_sub_pd(ay, cy)), _mm256_mul_pd(sy, _mm256_sub_pd(ax, cx)));
+            __m256d d2 = _mm256_sub_pd(_mm256_mul_pd(sx, _mm256_sub_pd(by, cy)), _mm256_mul_pd(sy, _mm256_sub_pd(bx, cx)));
+            __m256d d3 = _mm256_sub_pd(_mm256_mul_pd(ex, _mm256_sub_pd(cy, ay)), _mm256_mul_pd(ey, _mm256_sub_pd(cx, ax)));
+            __m256d d4 = _mm256_sub_pd(_mm256_mul_pd(ex, _mm256_sub_pd(dy, ay)), _mm256_mul_pd(ey, _mm256_sub_pd(dx, ax)));
+            __m256d hit = _mm256_and_pd(_mm256_or_pd(_mm256_cmp_pd(d1, zero, _CMP_LE_OQ), _mm256_cmp_pd(d2, zero, _CMP_LE_OQ)),
+                                        _mm256_or_pd(_mm256_cmp_pd(d1, zero, _CMP_GE_OQ), _mm256_cmp_pd(d2, zero, _CMP_GE_OQ)));
+            hit = _mm256_and_pd(hit, _mm256_and_pd(_mm256_or_pd(_mm256_cmp_pd(d3, zero, _CMP_LE_OQ), _mm256_cmp_pd(d4, zero, _CMP_LE_OQ)),
+                                                   _mm256_or_pd(_mm256_cmp_pd(d3, zero, _CMP_GE_OQ), _mm256_cmp_pd(d4, zero, _CMP_GE_OQ))));
+            __m256d lo_x = _mm256_max_pd(min_ax, _mm256_min_pd(cx, dx));
+            __m256d hi_x = _mm256_min_pd(max_ax, _mm256_max_pd(cx, dx));
+            __m256d lo_y = _mm256_max_pd(min_ay, _mm256_min_pd(cy, dy));
+            __m256d hi_y = _mm256_min_pd(max_ay, _mm256_max_pd(cy, dy));
+            hit = _mm256_and_pd(hit, _mm256_and_pd(_mm256_cmp_pd(lo_x, hi_x, _CMP_LE_OQ), _mm256_cmp_pd(lo_y, hi_y, _CMP_LE_OQ)));
+            __m128i orders = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&arrays.order[i]));
+            __m256i eligible = _mm256_cvtepi32_epi64(_mm_cmpgt_epi32(orders, order_floor));
+            __m256d uncertain = _mm256_or_pd(_mm256_or_pd(uncertain_avx2(d1, segment_bound), uncertain_avx2(d2, segment_bound)), 
+                                             _mm256_or_pd(uncertain_avx2(d3, leg_bound), uncertain_avx2(d4, leg_bound)));
+            if (_mm256_movemask_pd(_mm256_and_pd(uncertain, _mm256_castsi256_pd(eligible))) != 0)
+            {
+                if (any_intersection_scalar(arrays, i, i + 4, from_x, from_y, to_x, to_y, min_order))
+                {
+                    return true;
+                }
+                continue;
+            }
+            hit = _mm256_and_pd(hit, _mm256_castsi256_pd(eligible));
+            if (_mm256_movemask_pd(hit) != 0)
+            {
+                return true;
+            }
+        }
+        return any_intersection_scalar(arrays, i, end, from_x, from_y, to_x, to_y, min_order);
+    }
+    // Per lane: the orientation signs of the segment's ends against the leg (d3, d4 of segments_intersect),
+    // and for later segments the full closed intersection test, exactly as first_violation computes them.
+    __attribute__((target("sse2")))
+    bool IntersectionKernel::any_violation_sse2(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int max_order)
+    {
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d ax = _mm_set1_pd(from_x);
+        const __m128d ay = _mm_set1_pd(from_y);
+        const __m128d ex = _mm_set1_pd(to_x - from_x);
+        const __m128d ey = _mm_set1_pd(to_y - from_y);
+        const __m128d bx = _mm_set1_pd(to_x);
+        const __m128d by = _mm_set1_pd(to_y);
+        const __m128d min_ax = _mm_set1_pd(std::min(from_x, to_x));
+        const __m128d max_ax = _mm_set1_pd(std::max(from_x, to_x));
+        const __m128d min_ay = _mm_set1_pd(std::min(from_y, to_y));
+        const __m128d max_ay = _mm_set1_pd(std::max(from_y, to_y));
+        const LegBounds bounds = leg_bounds(arrays, from_x, from_y, to_x, to_y);
+        const __m128d leg_bound = _mm_set1_pd(bounds.leg);
+        const __m128d segment_bound = _mm_set1_pd(bounds.segment);
+        const __m128i order_ceiling = _mm_set1_epi32(max_order);
+        size_t i = begin;
+        for (; i + 2 <= end; i += 2)
+        {
+            __m128d cx = _mm_loadu_pd(&arrays.left_x[i]);
+            __m128d cy = _mm_loadu_pd(&arrays.left_y[i]);
+            __m128d dx = _mm_loadu_pd(&arrays.right_x[i]);
+            __m128d dy = _mm_loadu_pd(&arrays.right_y[i]);
+            __m128d d3 = _mm_sub_pd(_mm_mul_pd(ex, _mm_sub_pd(cy, ay)), _mm_mul_pd(ey, _mm_sub_pd(cx, ax)));
+            __m128d d4 = _mm_sub_pd(_mm_mul_pd(ex, _mm_sub_pd(dy, ay)), _mm_mul_pd(ey, _mm_sub_pd(dx, ax)));
+            __m128d bad = _mm_or_pd(_mm_cmple_pd(d3, zero), _mm_cmpge_pd(d4, zero));
+            __m128d sx = _mm_sub_pd(dx, cx);
+            __m128d sy = _mm_sub_pd(dy, cy);
+            __m128d d1 = _mm_sub_pd(_mm_mul_pd(sx, _mm_sub_pd(ay, cy)), _mm_mul_pd(sy, _mm_sub_pd(ax, cx)));
+            __m128d d2 = _mm_sub_pd(_mm_mul_pd(sx, _mm_sub_pd(by, cy)), _mm_mul_pd(sy, _mm_sub_pd(bx, cx)));
+            // With d3 > 0 > d4 the segment already straddles the leg's line; the leg only has to reach it.
+            __m128d hit = _mm_and_pd(_mm_or_pd(_mm_cmple_pd(d1, zero), _mm_cmple_pd(d2, zero)), _mm_or_pd(_mm_cmpge_pd(d1, zero), _mm_cmpge_pd(d2, zero)));
+            __m128d lo_x = _mm_max_pd(min_ax, _mm_min_pd(cx, dx));
+            __m128d hi_x = _mm_min_pd(max_ax, _mm_max_pd(cx, dx));
+            __m128d lo_y = _mm_max_pd(min_ay, _mm_min_pd(cy, dy));
+            __m128d hi_y = _mm_min_pd(max_ay, _mm_max_pd(cy, dy));
+            hit = _mm_and_pd(hit, _mm_and_pd(_mm_cmple_pd(lo_x, hi_x), _mm_cmple_pd(lo_y, hi_y)));
+            __m128i orders = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(&arrays.order[i]));
+            __m128i later = _mm_cmpgt_epi32(orders, order_ceiling);
+            __m128d later_lanes = _mm_castsi128_pd(_mm_unpacklo_epi32(later, later));
+            // The crossing signs only matter for later segments; the orientation signs matter for all.
+            __m128d uncertain = _mm_or_pd(_mm_or_pd(uncertain_sse2(d3, leg_bound), uncertain_sse2(d4, leg_bound)), 
+                                          _mm_and_pd(_mm_or_pd(uncertain_sse2(d1, segment_bound), uncertain_sse2(d2, segment_bound)), later_lanes));
+            if (_mm_movemask_pd(uncertain) != 0)
+            {
+                if (first_violation(arrays, i, i + 2, from_x, from_y, to_x, to_y, max_order) != ConstraintFailure::None)
+                {
+                    return true;
+                }
+                continue;
+            }
+            hit = _mm_and_pd(hit, later_lanes);
+            if (_mm_movemask_pd(_mm_or_pd(bad, hit)) != 0)
+            {
+                return true;
+            }
+        }
+        return first_violation(arrays, i, end, from_x, from_y, to_x, to_y, max_order) != ConstraintFailure::None;
+    }
+
+    __attribute__((target("avx2")))
+    bool IntersectionKernel::any_violation_avx2(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int max_order)
+    {
+        const __m256d zero = _mm256_setzero_pd();
+        const __m256d ax = _mm256_set1_pd(from_x);
+        const __m256d ay = _mm256_set1_pd(from_y);
+        const __m256d ex = _mm256_set1_pd(to_x - from_x);
+        const __m256d ey = _mm256_set1_pd(to_y - from_y);
+        const __m256d bx = _mm256_set1_pd(to_x);
+        const __m256d by = _mm256_set1_pd(to_y);
+        const __m256d min_ax = _mm256_set1_pd(std::min(from_x, to_x));
+        const __m256d max_ax = _mm256_set1_pd(std::max(from_x, to_x));
+        const __m256d min_ay = _mm256_set1_pd(std::min(from_y, to_y));
+        const __m256d max_ay = _mm256_set1_pd(std::max(from_y, to_y));
+        const LegBounds bounds = leg_bounds(arrays, from_x, from_y, to_x, to_y);
+        const __m256d leg_bound = _mm256_set1_pd(bounds.leg);
+        const __m256d segment_bound = _mm256_set1_pd(bounds.segment);
+        const __m128i order_ceiling = _mm_set1_epi32(max_order);
+        size_t i = begin;
+        for (; i + 4 <= end; i += 4)
+        {
+            __m256d cx = _mm256_loadu_pd(&arrays.left_x[i]);
+            __m256d cy = _mm256_loadu_pd(&arrays.left_y[i]);
+            __m256d dx = _mm256_loadu_pd(&arrays.right_x[i]);
+            __m256d dy = _mm256_loadu_pd(&arrays.right_y[i]);
+            __m256d d3 = _mm256_sub_pd(_mm256_mul_pd(ex, _mm256_sub_pd(cy, ay)), _mm256_mul_pd(ey, _mm256_sub_pd(cx, ax)));
+            __m256d d4 = _mm256_sub_pd(_mm256_mul_pd(ex, _mm256_sub_pd(dy, ay)), _mm256_mul_pd(ey, _mm256_sub_pd(dx, ax)));
+            __m256d bad = _mm256_or_pd(_mm256_cmp_pd(d3, zero, _CMP_LE_OQ), _mm256_cmp_pd(d4, zero, _CMP_GE_OQ));
+            __m256d sx = _mm256_sub_pd(dx, cx);
+            __m256d sy = _mm256_sub_pd(dy, cy);
+            __m256d d1 = _mm256_sub_pd(_mm256_mul_pd(sx, _mm256_sub_pd(ay, cy)), _mm256_mul_pd(sy, _mm256_sub_pd(ax, cx)));
+            __m256d d2 = _mm256_sub_pd(_mm256_mul_pd(sx, _mm256_sub_pd(by, cy)), _mm256_mul_pd(sy, _mm256_sub_pd(bx, cx)));
+            __m256d hit = _mm256_and_pd(_mm256_or_pd(_mm256_cmp_pd(d1, zero, _CMP_LE_OQ), _mm256_cmp_pd(d2, zero, _CMP_LE_OQ)),
+                                        _mm256_or_pd(_mm256_cmp_pd(d1, zero, _CMP_GE_OQ), _mm256_cmp_pd(d2, zero, _CMP_GE_OQ)));
+            __m256d lo_x = _mm256_max_pd(min_ax, _mm256_min_pd(cx, dx));
+            __m256d hi_x = _mm256_min_pd(max_ax, _mm256_max_pd(cx, dx));
+            __m256d lo_y = _mm256_max_pd(min_ay, _mm256_min_pd(cy, dy));
+            __m256d hi_y = _mm256_min_pd(max_ay, _mm256_max_pd(cy, dy));
+            hit = _mm256_and_pd(hit, _mm256_and_pd(_mm256_cmp_pd(lo_x, hi_x, _CMP_LE_OQ), _mm256_cmp_pd(lo_y, hi_y, _CMP_LE_OQ)));
+            __m128i orders = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&arrays.order[i]));
+            __m256i later = _mm256_cvtepi32_epi64(_mm_cmpgt_epi32(orders, order_ceiling));
+            __m256d later_lanes = _mm256_castsi256_pd(later);
+            __m256d uncertain = _mm256_or_pd(_mm256_or_pd(uncertain_avx2(d3, leg_bound), uncertain_avx2(d4, leg_bound)), 
+                                             _mm256_and_pd(_mm256_or_pd(uncertain_avx2(d1, segment_bound), uncertain_avx2(d2, segment_bound)), later_lanes));
+            if (_mm256_movemask_pd(uncertain) != 0)
+            {
+                if (first_violation(arrays, i, i + 4, from_x, from_y, to_x, to_y, max_order) != ConstraintFailure::None)
+                {
+                    return true;
+                }
+                continue;
+            }
+            hit = _mm256_and_pd(hit, later_lanes);
+            if (_mm256_movemask_pd(_mm256_or_pd(bad, hit)) != 0)
+            {
+                return true;
+            }
+        }
+        return first_violation(arrays, i, end, from_x, from_y, to_x, to_y, max_order) != ConstraintFailure::None;
+    }
+#else
+    bool IntersectionKernel::any_intersection_sse2(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int min_order)
+    {
+        return any_intersection_scalar(arrays, begin, end, from_x, from_y, to_x, to_y, min_order);
+    }
+
+    bool IntersectionKernel::any_intersection_avx2(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int min_order)
+    {
+        return any_intersection_scalar(arrays, begin, end, from_x, from_y, to_x, to_y, min_order);
+    }
+
+    bool IntersectionKernel::any_violation_sse2(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int max_order)
+    {
+        return first_violation(arrays, begin, end, from_x, from_y, to_x, to_y, max_order) != ConstraintFailure::None;
+    }
+
+    bool IntersectionKernel::any_violation_avx2(const SegmentArrays& arrays, size_t begin, size_t end, double from_x, double from_y, double to_x, double to_y, int max_order)
+    {
+        return first_violation(arrays, begin, end, from_x, from_y, to_x, to_y, max_order) != ConstraintFailure::None;
+    }
+#endif
+}
@@ -1,120 +1,269 @@
 #include "shortest_path.h"
+#include "continuous_crossing.h"
+#include "windowed_solver.h"
+#include "k_shortest_paths.h"
+#include "graph_search.h"
+#include "metrics.h"
 #include <iostream>
 #include <algorithm>
 #include <climits>
+#include <stdexcept>
 namespace marine_nav 
 {
-    ShortestPathSolver::ShortestPathSolver() {}
+    ShortestPathSolver::ShortestPathSolver() : lazy_graph_(false), algorithm_(SearchAlgorithm::Dijkstra), window_size_(256), window_overlap_(16) {}
+
+    ShortestPathSolver::~ShortestPathSolver() = default;
+
+    void ShortestPathSolver::set_window(size_t window, size_t overlap) 
+    {
+        if (overlap == 0 || window < 2 * overlap) 
+        {
+            throw std::invalid_argument("Windows need an overlap of at least 1 gateway and at least twice the overlap in size");
+        }
+        window_size_ = window;
+        window_overlap_ = overlap;
+    }
+
     PathResult ShortestPathSolver::solve(const std::vector<Segment>& segments, const Point& start, const Point& end) 
     {
-        PathResult result;
+        if (algorithm_ == SearchAlgorithm::ContinuousCrossing) 
+        {
+            ContinuousCrossingSolver continuous;
+            return continuous.solve(segments, start, end);
+        }
+        if (algorithm_ == SearchAlgorithm::Windowed) 
+        {
+            if (!windowed_) 
+            {
+                windowed_ = std::make_unique<WindowedSolver>(graph_);
+            }
+            windowed_->set_window(window_size_, window_overlap_);
+            windowed_->set_thread_count(graph_.get_thread_count());
+            return windowed_->solve(segments, start, end);
+        }
+        if (lazy_graph_ || algorithm_ == SearchAlgorithm::LayeredDag) 
+        {
+            graph_.build_lazy(segments, start, end);
+        }
+        else 
+        {
+            graph_.build_graph(segments, start, end);
+        }
+        return search(start, end);
+    }
+
+    PathResult ShortestPathSolver::solve(const std::vector<Segment>& segments, const Point& start, const Point& end, const ChartFile& chart) 
+    {
+        bool eager = !lazy_graph_ && algorithm_ != SearchAlgorithm::LayeredDag && algorithm_ != SearchAlgorithm::ContinuousCrossing 
+                     && algorithm_ != SearchAlgorithm::Windowed;
+        if (!chart.has_graph() || !eager) 
+        {
+            return solve(segments, start, end);
+        }
+        Point chart_start = chart.get_start();
+        Point chart_end = chart.get_end();
+        if (segments.size() != chart.get_segment_count() || start.x != chart_start.x || start.y != chart_start.y 
+            || end.x != chart_end.x || end.y != chart_end.y) 
+        {
+            throw std::runtime_error("Segments, start or end do not match the chart's precomputed graph");
+        }
+        graph_.attach_graph(segments, start, end, chart.get_row_offsets(), chart.get_row_targets(), chart.get_row_weights());
+        return search(start, end);
+    }
+
+    std::vector<PathResult> ShortestPathSolver::solve_alternatives(const std::vector<Segment>& segments, const Point& start, const Point& end, size_t k) 
+    {
         graph_.build_graph(segments, start, end);
-        int start_idx = graph_.find_node_index(start.label);
-        int end_idx = graph_.find_node_index(end.label);
+        int start_idx = graph_.find_node_index(start.label_id);
+        int end_idx = graph_.find_node_index(end.label_id);
+        if (start_idx == -1 || end_idx == -1) 
+        {
+            std::cerr << "Error: Could not find start or end node in graph\n";
+            return std::vector<PathResult>();
+        }
+        KShortestPaths finder(graph_);
+        std::vector<PathResult> routes = finder.find(start_idx, end_idx, k);
+        if (!routes.empty()) 
+        {
+            routes.front().nodes_settled = finder.get_nodes_settled();
+        }
+        return routes;
+    }
+
+    PathResult ShortestPathSolver::search(const Point& start, const Point& end) 
+    {
+        MARINE_NAV_PHASE("search");
+        PathResult result;
+        int start_idx = graph_.find_node_index(start.label_id);
+        int end_idx = graph_.find_node_index(end.label_id);
         if (start_idx == -1 || end_idx == -1) 
         {
             std::cerr << "Error: Could not find start or end node in graph\n";
             return result;
         }
-        const auto& adj_list = graph_.get_adjacency_list();
+        if (algorithm_ == SearchAlgorithm::LayeredDag) 
+        {
+            return solve_layered(start_idx, end_idx);
+        }
+        const double infinity = std::numeric_limits<double>::infinity();
+        workspace_.begin(graph_.get_node_count());
+        const double* heuristic = compute_heuristic(end, end_idx);
+        auto estimate = [heuristic](int node) { return heuristic ? heuristic[node] : 0.0; };
+        // Only forward edges, as in the layered sweep: each leg is then one the build checked in its
+        // direction of travel. The heuristic array survives search_from's begin, which reuses the storage.
+        result.nodes_settled = search_from(workspace_, graph_.get_node_count(), start_idx, end_idx, 
+            [this](int u, const auto& relax) 
+            {
+                NeighborRange row = forward_part(graph_.get_neighbors(u), u);
+                for (size_t k = 0; k < row.count; ++k) 
+                {
+                    relax(row.targets[k], row.weights[k]);
+                }
+            }, estimate);
+        if (workspace_.distance(end_idx) == infinity) 
+        {
+            std::cerr << "No path found from start to end\n";
+            return result;
+        }
+        result.total_distance = workspace_.distance(end_idx);
+        result.path = reconstruct_path(start_idx, end_idx);
+        result.found = true;
+        return result;
+    }
+    PathResult ShortestPathSolver::solve_layered(int start_idx, int end_idx) 
+    {
+        // Start, each gateway and end form layers ordered by segment_order. Edges only run from a
+        // layer to a later one, so a single sweep in layer order settles every node. Pairs are only
+        // evaluated out of nodes that are already reachable.
+        PathResult result;
         size_t num_nodes = graph_.get_node_count();
-        std::vector<double> distances(num_nodes, std::numeric_limits<double>::infinity());
-        std::vector<int> previous(num_nodes, -1);
-        std::vector<bool> visited(num_nodes, false);
-        std::priority_queue<DijkstraNode, std::vector<DijkstraNode>, std::greater<DijkstraNode>> pq;
-        distances[start_idx] = 0.0;
-        pq.emplace(start_idx, 0.0);
-        while (!pq.empty()) 
-        {
-            DijkstraNode current = pq.top();
-            pq.pop();    
-            int u = current.node_index;
-            if (visited[u]) 
+        const double infinity = std::numeric_limits<double>::infinity();
+        workspace_.begin(num_nodes);
+        std::vector<int>& sweep = workspace_.order;
+        sweep.resize(num_nodes);
+        for (size_t i = 0; i < num_nodes; ++i) 
+        {
+            sweep[i] = static_cast<int>(i);
+        }
+        std::stable_sort(sweep.begin(), sweep.end(), [this](int a, int b) 
+        {
+            return graph_.get_node(a).segment_order < graph_.get_node(b).segment_order;
+        });
+        workspace_.set_distance(start_idx, 0.0, -1);
+        size_t layer_end = 0;
+        for (size_t k = 0; k < sweep.size(); ++k) 
+        {
+            int u = sweep[k];
+            int layer = graph_.get_node(u).segment_order;
+            while (layer_end < sweep.size() && graph_.get_node(sweep[layer_end]).segment_order <= layer) 
+            {
+                ++layer_end;
+            }
+            double distance_u = workspace_.distance(u);
+            if (distance_u == infinity) 
             {
                 continue;
             }
-            visited[u] = true;
+            ++result.nodes_settled;
             if (u == end_idx) 
             {
                 break;
             }
-            for (const auto& edge : adj_list[u]) 
+            for (size_t m = layer_end; m < sweep.size(); ++m) 
             {
-                int v = edge.to_node;
-                double weight = edge.weight;    
-                if (!visited[v] && distances[u] + weight < distances[v]) 
+                int v = sweep[m];
+                if (!graph_.evaluate_pair(u, v)) 
+                {
+                    continue;
+                }
+                double candidate = distance_u + graph_.edge_weight(u, v);
+                if (candidate < workspace_.distance(v)) 
                 {
-                    distances[v] = distances[u] + weight;
-                    previous[v] = u;
-                    pq.emplace(v, distances[v]);
+                    workspace_.set_distance(v, candidate, u);
                 }
             }
         }
-        if (distances[end_idx] == std::numeric_limits<double>::infinity()) 
+        if (workspace_.distance(end_idx) == infinity) 
         {
             std::cerr << "No path found from start to end\n";
             return result;
         }
-        result.path = reconstruct_path(previous, start_idx, end_idx);
-        result.total_distance = distances[end_idx];
+        result.total_distance = workspace_.distance(end_idx);
+        result.path = reconstruct_path(start_idx, end_idx);
         result.found = true;
         return result;
     }
-    std::vector<Point> ShortestPathSolver::reconstruct_path(const std::vector<int>& previous, int start_idx, int end_idx) const 
+
+    const double* ShortestPathSolver::compute_heuristic(const Point& end, int end_idx) 
     {
-        std::vector<Point> path;
-        std::vector<int> path_indices;
-        int current = end_idx;
-        while (current != -1) 
-        {
-            path_indices.push_back(current);
-            current = previous[current];
-        }
-        std::reverse(path_indices.begin(), path_indices.end());
-        for (int idx : path_indices) 
+        if (algorithm_ == SearchAlgorithm::Dijkstra) 
         {
-            path.push_back(graph_.get_node(idx).point);
+            return nullptr;
         }
-        return path;
-    }
-
-    bool ShortestPathSolver::validate_path(const std::vector<Point>& path, const std::vector<Segment>& segments, const Point& start, const Point& end) const 
-    {
-        if (path.empty()) 
+        size_t num_nodes = graph_.get_node_count();
+        double* heuristic = workspace_.heuristic();
+        if (algorithm_ != SearchAlgorithm::AStarCorridor || graph_.is_lazy()) 
         {
-            return false;
+            // Lazy rows are unknown before expansion, and the ordering rule alone admits a direct leg to
+            // end from every node, so the straight line is the strongest bound available.
+            for (size_t i = 0; i < num_nodes; ++i) 
+            {
+                heuristic[i] = graph_.get_node(static_cast<int>(i)).point.distance_to(end);
+            }
+            return heuristic;
         }
-        if (path.front().label != start.label || path.back().label != end.label) 
+        // Forward edges only lead to higher indices, so one pass down from end settles the exact
+        // remaining distance of every node over the edges the search may take, skips included.
+        const double infinity = std::numeric_limits<double>::infinity();
+        for (size_t i = 0; i < num_nodes; ++i) 
         {
-            return false;
+            heuristic[i] = infinity;
         }
-        std::vector<int> segment_orders_visited;
-        for (const auto& point : path) 
+        heuristic[end_idx] = 0.0;
+        for (int u = static_cast<int>(num_nodes) - 1; u >= 0; --u) 
         {
-            for (const auto& segment : segments) 
+            NeighborRange row = forward_part(graph_.get_row(u), u);
+            for (size_t k = 0; k < row.count; ++k) 
             {
-                if (point.label == segment.left.label || point.label == segment.right.label) 
-                {
-                    segment_orders_visited.push_back(segment.order);
-                    break;
-                }
+                heuristic[u] = std::min(heuristic[u], row.weights[k] + heuristic[row.targets[k]]);
             }
         }
-        for (size_t i = 1; i < segment_orders_visited.size(); ++i) 
+        heuristic[end_idx] = 0.0;
+        return heuristic;
+    }
+
+    std::vector<Point> ShortestPathSolver::reconstruct_path(int start_idx, int end_idx) 
+    {
+        std::vector<int>& path_indices = workspace_.order;
+        path_indices.clear();
+        int current = end_idx;
+        while (current != -1) 
         {
-            if (segment_orders_visited[i] < segment_orders_visited[i-1]) 
-            {
-                return false;
-            }
+            path_indices.push_back(current);
+            current = workspace_.previous(current);
         }
-        GeometryEngine geometry_engine;
-        for (size_t i = 0; i < path.size() - 1; ++i) 
+        std::vector<Point> path;
+        path.reserve(path_indices.size());
+        for (auto it = path_indices.rbegin(); it != path_indices.rend(); ++it) 
         {
-            if (!geometry_engine.path_maintains_constraints({path[i], path[i+1]}, segments)) 
-            {
-                return false;
-            }
-        }   
-        return true;
+            path.push_back(graph_.get_node(*it).point);
+        }
+        return path;
+    }
+
+    bool ShortestPathSolver::validate_path(const std::vector<Point>& path, const std::vector<Segment>& segments, const Point& start, const Point& end) 
+    {
+        MARINE_NAV_PHASE("validate_path");
+        validator_.set_simd_level(graph_.get_geometry_engine().get_simd_level());
+        validator_.prepare(segments);
+        return validator_.validate(path, start, end);
+    }
+
+    bool ShortestPathSolver::validate_crossings(const std::vector<Point>& path, const std::vector<Segment>& segments, const Point& start, const Point& end) 
+    {
+        MARINE_NAV_PHASE("validate_crossings");
+        validator_.set_simd_level(graph_.get_geometry_engine().get_simd_level());
+        validator_.prepare(segments);
+        return validator_.validate_crossings(path, start, end);
     }
 } 
@@ -0,0 +1,86 @@
+#include "solver_workspace.h"
+#include <algorithm>
+#include <cstring>
+namespace marine_nav
+{
+    MonotonicArena::MonotonicArena(size_t block_size)
+        : current_(0), used_(0), block_size_(std::max<size_t>(block_size, 64)), block_allocations_(0) {}
+
+    void MonotonicArena::add_block(size_t min_bytes)
+    {
+        size_t bytes = std::max(block_size_, min_bytes);
+        blocks_.emplace_back(new unsigned char[bytes]);
+        block_sizes_.push_back(bytes);
+        ++block_allocations_;
+    }
+
+    void* MonotonicArena::allocate(size_t bytes, size_t alignment)
+    {
+        if (blocks_.empty())
+        {
+            add_block(bytes + alignment);
+        }
+        while (true)
+        {
+            uintptr_t base = reinterpret_cast<uintptr_t>(blocks_[current_].get());
+            size_t offset = ((base + used_ + alignment - 1) & ~(uintptr_t(alignment) - 1)) - base;
+            if (offset + bytes <= block_sizes_[current_])
+            {
+                used_ = offset + bytes;
+                return blocks_[current_].get() + offset;
+            }
+            if (current_ + 1 == blocks_.size())
+            {
+                add_block(bytes + alignment);
+            }
+            ++current_;
+            used_ = 0;
+        }
+    }
+
+    void MonotonicArena::reset()
+    {
+        if (blocks_.size() > 1)
+        {
+            size_t total = 0;
+            for (size_t bytes : block_sizes_)
+            {
+                total += bytes;
+            }
+            blocks_.clear();
+            block_sizes_.clear();
+            add_block(total);
+        }
+        current_ = 0;
+        used_ = 0;
+    }
+
+    SolverWorkspace::SolverWorkspace()
+        : capacity_(0), generation_(0), stamp_(nullptr), distance_(nullptr), previous_(nullptr), settled_(nullptr), heuristic_(nullptr) {}
+
+    void SolverWorkspace::begin(size_t node_count)
+    {
+        heap.clear();
+        order.clear();
+        if (node_count > capacity_)
+        {
+            // Grow geometrically so a slowly growing workload re-carves the arrays only O(log n) times.
+            size_t capacity = std::max(node_count, capacity_ * 2);
+            arena_.reset();
+            stamp_ = arena_.allocate_array<uint32_t>(capacity);
+            distance_ = arena_.allocate_array<double>(capacity);
+            previous_ = arena_.allocate_array<int>(capacity);
+            settled_ = arena_.allocate_array<double>(capacity);
+            heuristic_ = arena_.allocate_array<double>(capacity);
+            std::memset(stamp_, 0, capacity * sizeof(uint32_t));
+            capacity_ = capacity;
+            generation_ = 0;
+        }
+        if (++generation_ == 0)
+        {
+            // Stamps wrapped: clear them once so no stale entry matches the new generation.
+            std::memset(stamp_, 0, capacity_ * sizeof(uint32_t));
+            generation_ = 1;
+        }
+    }
+}
@@ -0,0 +1,389 @@
+#include "spatial_index.h"
+#include "geometry.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+namespace marine_nav
+{
+    namespace
+    {
+        struct Box
+        {
+            double min_x, min_y, max_x, max_y;
+        };
+
+        // Sort-Tile-Recursive order: vertical slices by x centre, then y centre inside each slice.
+        std::vector<size_t> str_order(const std::vector<Box>& boxes, size_t capacity)
+        {
+            std::vector<size_t> order(boxes.size());
+            std::iota(order.begin(), order.end(), 0);
+            auto center_x = [&](size_t i) { return boxes[i].min_x + boxes[i].max_x; };
+            auto center_y = [&](size_t i) { return boxes[i].min_y + boxes[i].max_y; };
+            std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return center_x(a) < center_x(b); });
+            size_t groups = (boxes.size() + capacity - 1) / capacity;
+            size_t slices = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(groups))));
+            size_t slice_size = slices * capacity;
+            for (size_t begin = 0; begin < order.size(); begin += slice_size)
+            {
+                auto first = order.begin() + begin;
+                auto last = order.begin() + std::min(begin + slice_size, order.size());
+                std::sort(first, last, [&](size_t a, size_t b) { return center_y(a) < center_y(b); });
+            }
+            return order;
+        }
+    }
+
+    SegmentIndex::SegmentIndex(size_t node_capacity) 
+        : node_capacity_(std::min<size_t>(std::max<size_t>(node_capacity, 2), 32)) {}
+
+    void SegmentIndex::clear()
+    {
+        arrays_.clear();
+        segment_ids_.clear();
+        nodes_.clear();
+    }
+
+    void SegmentIndex::build(const std::vector<Segment>& segments)
+    {
+        clear();
+        if (segments.empty())
+        {
+            return;
+        }
+        std::vector<Box> boxes;
+        boxes.reserve(segments.size());
+        for (const auto& segment : segments)
+        {
+            boxes.push_back(Box{std::min(segment.left.x, segment.right.x), std::min(segment.left.y, segment.right.y),
+                                std::max(segment.left.x, segment.right.x), std::max(segment.left.y, segment.right.y)});
+        }
+        std::vector<size_t> order = str_order(boxes, node_capacity_);
+        std::vector<Segment> ordered;
+        ordered.reserve(segments.size());
+        segment_ids_.reserve(segments.size());
+        for (size_t index : order)
+        {
+            ordered.push_back(segments[index]);
+            segment_ids_.push_back(static_cast<int>(index));
+        }
+        arrays_.assign(ordered);
+        for (size_t begin = 0; begin < order.size(); begin += node_capacity_)
+        {
+            size_t end = std::min(begin + node_capacity_, order.size());
+            Node leaf{boxes[order[begin]].min_x, boxes[order[begin]].min_y, boxes[order[begin]].max_x, boxes[order[begin]].max_y,
+                      static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin), true};
+            for (size_t k = begin + 1; k < end; ++k)
+            {
+                const Box& box = boxes[order[k]];
+                leaf.min_x = std::min(leaf.min_x, box.min_x);
+                leaf.min_y = std::min(leaf.min_y, box.min_y);
+                leaf.max_x = std::max(leaf.max_x, box.max_x);
+                leaf.max_y = std::max(leaf.max_y, box.max_y);
+            }
+            nodes_.push_back(leaf);
+        }
+        // Each pass STR-orders the current level in place, then packs consecutive runs into parents.
+        size_t level_begin = 0;
+        size_t level_end = nodes_.size();
+        while (level_end - level_begin > 1)
+        {
+            std::vector<Box> level_boxes;
+            for (size_t i = level_begin; i < level_end; ++i)
+            {
+                level_boxes.push_back(Box{nodes_[i].min_x, nodes_[i].min_y, nodes_[i].max_x, nodes_[i].max_y});
+            }
+            std::vector<size_t> level_order = str_order(level_boxes, node_capacity_);
+            std::vector<Node> level(nodes_.begin() + level_begin, nodes_.begin() + level_end);
+            for (size_t k = 0; k < level_order.size(); ++k)
+            {
+                nodes_[level_begin + k] = level[level_order[k]];
+            }
+            for (size_t begin = level_begin; begin < level_end; begin += node_capacity_)
+            {
+                size_t end = std::min(begin + node_capacity_, level_end);
+                Node parent{nodes_[begin].min_x, nodes_[begin].min_y, nodes_[begin].max_x, nodes_[begin].max_y,
+                            static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin), false};
+                for (size_t k = begin + 1; k < end; ++k)
+                {
+                    parent.min_x = std::min(parent.min_x, nodes_[k].min_x);
+                    parent.min_y = std::min(parent.min_y, nodes_[k].min_y);
+                    parent.max_x = std::max(parent.max_x, nodes_[k].max_x);
+                    parent.max_y = std::max(parent.max_y, nodes_[k].max_y);
+                }
+                nodes_.push_back(parent);
+            }
+            level_begin = level_end;
+            level_end = nodes_.size();
+        }
+    }
+
+    bool SegmentIndex::node_misses_line(const Node& node, double from_x, double from_y, double to_x, double to_y)
+    {
+        // A half-plane is convex and the orientations are exact, so if every corner lies strictly on one
+        // side of the line, so does every endpoint stored below this node.
+        double c0 = IntersectionKernel::orientation(from_x, from_y, to_x, to_y, node.min_x, node.min_y);
+        double c1 = IntersectionKernel::orientation(from_x, from_y, to_x, to_y, node.max_x, node.min_y);
+        double c2 = IntersectionKernel::orientation(from_x, from_y, to_x, to_y, node.min_x, node.max_y);
+        double c3 = IntersectionKernel::orientation(from_x, from_y, to_x, to_y, node.max_x, node.max_y);
+        return (c0 > 0 && c1 > 0 && c2 > 0 && c3 > 0) || (c0 < 0 && c1 < 0 && c2 < 0 && c3 < 0);
+    }
+
+    void SegmentIndex::query(double min_x, double min_y, double max_x, double max_y, std::vector<int>& out) const
+    {
+        if (nodes_.empty())
+        {
+            return;
+        }
+        uint32_t stack[256];
+        size_t top = 0;
+        stack[top++] = static_cast<uint32_t>(nodes_.size() - 1);
+        while (top > 0)
+        {
+            const Node& node = nodes_[stack[--top]];
+            if (node.min_x > max_x || node.max_x < min_x || node.min_y > max_y || node.max_y < min_y)
+            {
+                continue;
+            }
+            for (uint32_t k = node.first; k < node.first + node.count; ++k)
+            {
+                if (!node.leaf)
+                {
+                    stack[top++] = k;
+                    continue;
+                }
+                double seg_min_x = std::min(arrays_.left_x[k], arrays_.right_x[k]);
+                double seg_max_x = std::max(arrays_.left_x[k], arrays_.right_x[k]);
+                double seg_min_y = std::min(arrays_.left_y[k], arrays_.right_y[k]);
+                double seg_max_y = std::max(arrays_.left_y[k], arrays_.right_y[k]);
+                if (seg_min_x <= max_x && seg_max_x >= min_x && seg_min_y <= max_y && seg_max_y >= min_y)
+                {
+                    out.push_back(segment_ids_[k]);
+                }
+            }
+        }
+    }
+
+    bool SegmentIndex::any_intersection(double from_x, double from_y, double to_x, double to_y, int min_order, SimdLevel level) const
+    {
+        if (nodes_.empty())
+        {
+            return false;
+        }
+        double min_x = std::min(from_x, to_x);
+        double max_x = std::max(from_x, to_x);
+        double min_y = std::min(from_y, to_y);
+        double max_y = std::max(from_y, to_y);
+        uint32_t stack[256];
+        size_t top = 0;
+        stack[top++] = static_cast<uint32_t>(nodes_.size() - 1);
+        while (top > 0)
+        {
+            const Node& node = nodes_[stack[--top]];
+            if (node.min_x > max_x || node.max_x < min_x || node.min_y > max_y || node.max_y < min_y)
+            {
+                continue;
+            }
+            if (node_misses_line(node, from_x, from_y, to_x, to_y))
+            {
+                continue;
+            }
+            if (node.leaf)
+            {
+                if (IntersectionKernel::any_intersection(arrays_, node.first, node.first + node.count, from_x, from_y, to_x, to_y, min_order, level))
+                {
+                    return true;
+                }
+                continue;
+            }
+            for (uint32_t k = node.first; k < node.first + node.count; ++k)
+            {
+                stack[top++] = k;
+            }
+        }
+        return false;
+    }
+
+    namespace
+    {
+        const double kPi = 3.14159265358979323846;
+
+        bool angle_between(double angle, double lo, double hi)
+        {
+            double offset = std::fmod(angle - lo, 2 * kPi);
+            if (offset < 0)
+            {
+                offset += 2 * kPi;
+            }
+            return offset <= hi - lo;
+        }
+
+        // Range of n(theta) . p over theta in [lo, hi], where n(theta) = (-sin theta, cos theta) is the
+        // port normal of a direction theta. The dot product is |p| cos(theta - phi), a sinusoid.
+        void normal_offset_range(double x, double y, double lo, double hi, double& low, double& high)
+        {
+            double at_lo = y * std::cos(lo) - x * std::sin(lo);
+            double at_hi = y * std::cos(hi) - x * std::sin(hi);
+            low = std::min(at_lo, at_hi);
+            high = std::max(at_lo, at_hi);
+            double radius = std::hypot(x, y);
+            double phi = std::atan2(-x, y);
+            if (angle_between(phi, lo, hi))
+            {
+                high = radius;
+            }
+            if (angle_between(phi + kPi, lo, hi))
+            {
+                low = -radius;
+            }
+        }
+    }
+
+    EdgeIndex::EdgeIndex(size_t node_capacity) 
+        : node_capacity_(std::min<size_t>(std::max<size_t>(node_capacity, 2), 32)) {}
+
+    void EdgeIndex::clear()
+    {
+        entries_.clear();
+        degenerate_.clear();
+        nodes_.clear();
+    }
+
+    void EdgeIndex::build(const std::vector<Edge>& edges)
+    {
+        clear();
+        std::vector<Entry> entries;
+        entries.reserve(edges.size());
+        for (const auto& edge : edges)
+        {
+            double dx = edge.to_x - edge.from_x;
+            double dy = edge.to_y - edge.from_y;
+            if (dx == 0 && dy == 0)
+            {
+                degenerate_.push_back(edge.key);
+                continue;
+            }
+            double theta = std::atan2(dy, dx);
+            entries.push_back(Entry{theta, edge.from_y * std::cos(theta) - edge.from_x * std::sin(theta),
+                                    std::min(edge.from_x, edge.to_x), std::min(edge.from_y, edge.to_y),
+                                    std::max(edge.from_x, edge.to_x), std::max(edge.from_y, edge.to_y), edge.key});
+        }
+        if (entries.empty())
+        {
+            return;
+        }
+        // STR over the (theta, rho) points, as SegmentIndex does over segment boxes.
+        std::vector<Box> points;
+        points.reserve(entries.size());
+        for (const auto& entry : entries)
+        {
+            points.push_back(Box{entry.theta, entry.rho, entry.theta, entry.rho});
+        }
+        std::vector<size_t> order = str_order(points, node_capacity_);
+        entries_.reserve(entries.size());
+        for (size_t index : order)
+        {
+            entries_.push_back(entries[index]);
+        }
+        auto extend = [](Node& node, const Node& child)
+        {
+            node.theta_min = std::min(node.theta_min, child.theta_min);
+            node.theta_max = std::max(node.theta_max, child.theta_max);
+            node.rho_min = std::min(node.rho_min, child.rho_min);
+            node.rho_max = std::max(node.rho_max, child.rho_max);
+            node.min_x = std::min(node.min_x, child.min_x);
+            node.min_y = std::min(node.min_y, child.min_y);
+            node.max_x = std::max(node.max_x, child.max_x);
+            node.max_y = std::max(node.max_y, child.max_y);
+        };
+        for (size_t begin = 0; begin < entries_.size(); begin += node_capacity_)
+        {
+            size_t end = std::min(begin + node_capacity_, entries_.size());
+            const Entry& first = entries_[begin];
+            Node leaf{first.theta, first.theta, first.rho, first.rho, first.min_x, first.min_y, first.max_x, first.max_y,
+                      static_cast<uint32_t>(begin), static_cast<uint32_t>(end - begin), true};
+            for (size_t k = begin + 1; k < end; ++k)
+            {
+                const Entry& entry = entries_[k];
+                extend(leaf, Node{entry.theta, entry.theta, entry.rho, entry.rho, entry.min_x, entry.min_y, entry.max_x, entry.max_y, 0, 0, true});
+            }
+            nodes_.push_back(leaf);
+        }
+        // Leaves are already in STR order, so each level packs consecutive runs of the one below.
+        size_t level_begin = 0;
+        size_t level_end = nodes_.size();
+        while (level_end - level_begin > 1)
+        {
+            for (size_t begin = level_begin; begin < level_end; begin += node_capacity_)
+            {
+                size_t end = std::min(begin + node_capacity_, level_end);
+                Node parent = nodes_[begin];
+                parent.first = static_cast<uint32_t>(begin);
+                parent.count = static_cast<uint32_t>(end - begin);
+                parent.leaf = false;
+                for (size_t k = begin + 1; k < end; ++k)
+                {
+                    extend(parent, nodes_[k]);
+                }
+                nodes_.push_back(parent);
+            }
+            level_begin = level_end;
+            level_end = nodes_.size();
+        }
+    }
+
+    bool EdgeIndex::may_block(const Node& node, const Segment& segment)
+    {
+        // A segment whose box meets the node's may cross one of its edges.
+        if (std::min(segment.left.x, segment.right.x) <= node.max_x && std::max(segment.left.x, segment.right.x) >= node.min_x 
+            && std::min(segment.left.y, segment.right.y) <= node.max_y && std::max(segment.left.y, segment.right.y) >= node.min_y)
+        {
+            return true;
+        }
+        // Otherwise only orientation can block: an edge keeps the left end strictly to port exactly when
+        // n(theta) . left > rho, and the right end strictly to starboard when n(theta) . right < rho. The
+        // margin covers the rounding of theta and rho, so an edge left out here is certainly not blocked.
+        double scale = 1.0;
+        for (double value : {node.min_x, node.min_y, node.max_x, node.max_y, segment.left.x, segment.left.y, segment.right.x, segment.right.y})
+        {
+            scale = std::max(scale, std::fabs(value));
+        }
+        double margin = 1e-9 * scale;
+        double left_low, left_high, right_low, right_high;
+        normal_offset_range(segment.left.x, segment.left.y, node.theta_min, node.theta_max, left_low, left_high);
+        normal_offset_range(segment.right.x, segment.right.y, node.theta_min, node.theta_max, right_low, right_high);
+        return !(left_low - node.rho_max > margin && node.rho_min - right_high > margin);
+    }
+
+    void EdgeIndex::query(const Segment& segment, std::vector<uint64_t>& out) const
+    {
+        out.insert(out.end(), degenerate_.begin(), degenerate_.end());
+        if (nodes_.empty())
+        {
+            return;
+        }
+        uint32_t stack[256];
+        size_t top = 0;
+        stack[top++] = static_cast<uint32_t>(nodes_.size() - 1);
+        while (top > 0)
+        {
+            const Node& node = nodes_[stack[--top]];
+            if (!may_block(node, segment))
+            {
+                continue;
+            }
+            for (uint32_t k = node.first; k < node.first + node.count; ++k)
+            {
+                if (!node.leaf)
+                {
+                    stack[top++] = k;
+                    continue;
+                }
+                const Entry& entry = entries_[k];
+                if (may_block(Node{entry.theta, entry.theta, entry.rho, entry.rho, entry.min_x, entry.min_y, entry.max_x, entry.max_y, 0, 0, true}, segment))
+                {
+                    out.push_back(entry.key);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,155 @@
+#include "thread_pool.h"
+#include <algorithm>
+namespace marine_nav
+{
+    ThreadPool::ThreadPool(size_t thread_count)
+        : task_(nullptr), generation_(0), active_workers_(0), pending_ranges_(0), failed_(false), stopping_(false)
+    {
+        thread_count = resolve_thread_count(thread_count);
+        for (size_t i = 0; i < thread_count; ++i)
+        {
+            queues_.push_back(std::make_unique<WorkQueue>());
+        }
+        for (size_t i = 1; i < thread_count; ++i)
+        {
+            threads_.emplace_back(&ThreadPool::worker_loop, this, i);
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            stopping_ = true;
+        }
+        work_ready_.notify_all();
+        for (auto& thread : threads_)
+        {
+            thread.join();
+        }
+    }
+
+    size_t ThreadPool::resolve_thread_count(size_t requested)
+    {
+        if (requested == 0)
+        {
+            requested = std::thread::hardware_concurrency();
+        }
+        return std::max<size_t>(requested, 1);
+    }
+
+    void ThreadPool::parallel_for(size_t count, size_t grain, const RangeTask& task)
+    {
+        if (count == 0)
+        {
+            return;
+        }
+        grain = std::max<size_t>(grain, 1);
+        if (queues_.size() == 1 || count <= grain)
+        {
+            task(0, count, 0);
+            return;
+        }
+        size_t chunk = 0;
+        for (size_t begin = 0; begin < count; begin += grain, ++chunk)
+        {
+            WorkQueue& queue = *queues_[chunk % queues_.size()];
+            queue.ranges.emplace_back(begin, std::min(begin + grain, count));
+        }
+        pending_ranges_.store(chunk);
+        failed_.store(false);
+        {
+            std::lock_guard<std::mutex> lock(state_mutex_);
+            task_ = &task;
+            active_workers_ = threads_.size();
+            ++generation_;
+        }
+        work_ready_.notify_all();
+        drain(0);
+        std::unique_lock<std::mutex> lock(state_mutex_);
+        work_done_.wait(lock, [this]() { return active_workers_ == 0; });
+        task_ = nullptr;
+        if (error_)
+        {
+            std::exception_ptr error = error_;
+            error_ = nullptr;
+            std::rethrow_exception(error);
+        }
+    }
+
+    void ThreadPool::worker_loop(size_t worker)
+    {
+        size_t seen_generation = 0;
+        while (true)
+        {
+            {
+                std::unique_lock<std::mutex> lock(state_mutex_);
+                work_ready_.wait(lock, [&]() { return stopping_ || generation_ != seen_generation; });
+                if (stopping_)
+                {
+                    return;
+                }
+                seen_generation = generation_;
+            }
+            drain(worker);
+            {
+                std::lock_guard<std::mutex> lock(state_mutex_);
+                --active_workers_;
+            }
+            work_done_.notify_one();
+        }
+    }
+
+    void ThreadPool::drain(size_t worker)
+    {
+        std::pair<size_t, size_t> range;
+        while (pending_ranges_.load() > 0 && pop_range(worker, range))
+        {
+            // After a failure the remaining ranges are still popped, so every queue is empty when
+            // parallel_for returns, but the task no longer runs.
+            if (!failed_.load())
+            {
+                try
+                {
+                    (*task_)(range.first, range.second, worker);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(state_mutex_);
+                    if (!error_)
+                    {
+                        error_ = std::current_exception();
+                    }
+                    failed_.store(true);
+                }
+            }
+            pending_ranges_.fetch_sub(1);
+        }
+    }
+
+    bool ThreadPool::pop_range(size_t worker, std::pair<size_t, size_t>& range)
+    {
+        {
+            WorkQueue& own = *queues_[worker];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.ranges.empty())
+            {
+                range = own.ranges.back();
+                own.ranges.pop_back();
+                return true;
+            }
+        }
+        for (size_t offset = 1; offset < queues_.size(); ++offset)
+        {
+            WorkQueue& victim = *queues_[(worker + offset) % queues_.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.ranges.empty())
+            {
+                range = victim.ranges.front();
+                victim.ranges.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+}
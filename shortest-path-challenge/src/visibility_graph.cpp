@@ -1,13 +1,28 @@
 #include "visibility_graph.h"
+#include "metrics.h"
 #include <iostream>
 #include <algorithm>
+#include <climits>
 namespace marine_nav 
 {
-    VisibilityGraph::VisibilityGraph() {}
-    void VisibilityGraph::build_graph(const std::vector<Segment>& segments, const Point& start, const Point& end) 
+    VisibilityGraph::VisibilityGraph() 
+        : row_offsets_(nullptr), row_targets_(nullptr), row_weights_(nullptr), row_entry_count_(0), attached_(false), 
+          adjacency_view_valid_(false), thread_count_(1), segments_(nullptr), lazy_(false), fused_constraints_(true), pairs_evaluated_(0), 
+          projection_(nullptr) {}
+
+    void VisibilityGraph::set_thread_count(size_t thread_count)
     {
-        nodes_.clear();
-        adjacency_list_.clear();
+        thread_count = ThreadPool::resolve_thread_count(thread_count);
+        if (thread_count != thread_count_)
+        {
+            thread_pool_.reset();
+        }
+        thread_count_ = thread_count;
+    }
+
+    void VisibilityGraph::create_nodes(const std::vector<Segment>& segments, const Point& start, const Point& end, bool prepare_geometry) 
+    {
+        reset(segments, prepare_geometry);
         nodes_.emplace_back(start, -1, false);
         for (const auto& segment : segments) 
         {
@@ -15,7 +30,262 @@ namespace marine_nav
             nodes_.emplace_back(segment.right, segment.order, false); 
         }
         nodes_.emplace_back(end, INT_MAX, false);
-        adjacency_list_.resize(nodes_.size());
+        prepare_geodesic();
+    }
+
+    void VisibilityGraph::prepare_geodesic() 
+    {
+        if (!projection_) 
+        {
+            geodesic_nodes_.clear();
+            return;
+        }
+        std::vector<Point> geographic;
+        geographic.reserve(nodes_.size());
+        for (const auto& node : nodes_) 
+        {
+            geographic.push_back(projection_->unproject(node.point));
+        }
+        geodesic_nodes_.assign(geographic);
+    }
+
+    void VisibilityGraph::apply_geodesic_weights(int node, size_t begin, size_t end) 
+    {
+        GeodesicKernel::row_distances(geodesic_nodes_, node, targets_.data() + begin, end - begin, weights_.data() + begin, 
+                                      geometry_engine_.get_simd_level());
+    }
+
+    void VisibilityGraph::reset(const std::vector<Segment>& segments, bool prepare_geometry) 
+    {
+        nodes_.clear();
+        offsets_.clear();
+        targets_.clear();
+        weights_.clear();
+        row_offsets_ = nullptr;
+        row_targets_ = nullptr;
+        row_weights_ = nullptr;
+        row_entry_count_ = 0;
+        attached_ = false;
+        lazy_row_begin_.clear();
+        lazy_row_end_.clear();
+        adjacency_view_.clear();
+        adjacency_view_valid_ = false;
+        expanded_.clear();
+        if (prepare_geometry) 
+        {
+            geometry_engine_.prepare_segments(segments);
+        }
+        else 
+        {
+            geometry_engine_.clear_prepared_segments();
+        }
+        segments_ = &segments;
+    }
+
+    void VisibilityGraph::build_graph(const std::vector<Segment>& segments, const Point& start, const Point& end) 
+    {
+        MARINE_NAV_PHASE("build_graph");
+        create_nodes(segments, start, end);
+        lazy_ = false;
+        pairs_evaluated_ = get_eager_pair_count();
+        if (thread_count_ > 1) 
+        {
+            build_edges_parallel(segments);
+        }
+        else 
+        {
+            build_edges_serial(segments);
+        }
+    }
+
+    void VisibilityGraph::build_gateway_graph(const std::vector<Segment>& segments) 
+    {
+        MARINE_NAV_PHASE("build_gateway_graph");
+        reset(segments);
+        for (const auto& segment : segments) 
+        {
+            nodes_.emplace_back(segment.left, segment.order, true);  
+            nodes_.emplace_back(segment.right, segment.order, false); 
+        }
+        prepare_geodesic();
+        lazy_ = false;
+        pairs_evaluated_ = get_eager_pair_count();
+        if (thread_count_ > 1) 
+        {
+            build_edges_parallel(segments);
+        }
+        else 
+        {
+            build_edges_serial(segments);
+        }
+    }
+
+    void VisibilityGraph::attach_graph(const std::vector<Segment>& segments, const Point& start, const Point& end, 
+                                       const size_t* offsets, const int* targets, const double* weights) 
+    {
+        // The geometry caches are only needed to evaluate pairs, which an adopted graph never does.
+        create_nodes(segments, start, end, false);
+        lazy_ = false;
+        attached_ = true;
+        pairs_evaluated_ = 0;
+        row_offsets_ = offsets;
+        row_targets_ = targets;
+        row_weights_ = weights;
+        row_entry_count_ = offsets[nodes_.size()];
+    }
+
+    bool VisibilityGraph::can_connect(const GraphNode& from, const GraphNode& to, const GeometryEngine& engine) const 
+    {
+        return can_connect_nodes(from, to, *segments_, engine);
+    }
+
+    double VisibilityGraph::edge_weight(int a, int b) const 
+    {
+        if (projection_) 
+        {
+            double weight;
+            GeodesicKernel::row_distances(geodesic_nodes_, a, &b, 1, &weight, geometry_engine_.get_simd_level());
+            return weight;
+        }
+        return geometry_engine_.calculate_distance(nodes_[a].point, nodes_[b].point);
+    }
+
+    void VisibilityGraph::build_lazy(const std::vector<Segment>& segments, const Point& start, const Point& end) 
+    {
+        create_nodes(segments, start, end);
+        lazy_ = true;
+        pairs_evaluated_ = 0;
+        expanded_.assign(nodes_.size(), 0);
+        lazy_row_begin_.assign(nodes_.size(), 0);
+        lazy_row_end_.assign(nodes_.size(), 0);
+    }
+
+    NeighborRange VisibilityGraph::get_row(int node) const 
+    {
+        if (lazy_) 
+        {
+            size_t begin = lazy_row_begin_[node];
+            return NeighborRange{targets_.data() + begin, weights_.data() + begin, lazy_row_end_[node] - begin};
+        }
+        size_t begin = row_offsets_[node];
+        return NeighborRange{row_targets_ + begin, row_weights_ + begin, row_offsets_[node + 1] - begin};
+    }
+
+    NeighborRange VisibilityGraph::get_neighbors(int node) 
+    {
+        if (!lazy_ || expanded_[node]) 
+        {
+            return get_row(node);
+        }
+        // Pairs are always tested lower index first, exactly like the eager loop. A pair whose other
+        // end is already expanded is answered from that row (sorted by target) instead of re-tested.
+        size_t row_begin = targets_.size();
+        for (size_t j = 0; j < nodes_.size(); ++j) 
+        {
+            int other = static_cast<int>(j);
+            if (other == node) 
+            {
+                continue;
+            }
+            bool connected;
+            if (expanded_[other]) 
+            {
+                const int* first = targets_.data() + lazy_row_begin_[other];
+                const int* last = targets_.data() + lazy_row_end_[other];
+                connected = std::binary_search(first, last, node);
+            }
+            else 
+            {
+                connected = evaluate_pair(node, other);
+            }
+            if (connected) 
+            {
+                targets_.push_back(other);
+                weights_.push_back(geometry_engine_.calculate_distance(nodes_[node].point, nodes_[other].point));
+            }
+        }
+        if (projection_) 
+        {
+            apply_geodesic_weights(node, row_begin, targets_.size());
+        }
+        lazy_row_begin_[node] = row_begin;
+        lazy_row_end_[node] = targets_.size();
+        expanded_[node] = 1;
+        adjacency_view_valid_ = false;
+        return get_row(node);
+    }
+
+    bool VisibilityGraph::evaluate_pair(int a, int b) 
+    {
+        ++pairs_evaluated_;
+        return can_connect_nodes(nodes_[std::min(a, b)], nodes_[std::max(a, b)], *segments_);
+    }
+
+    const std::vector<std::vector<GraphEdge>>& VisibilityGraph::get_adjacency_list() const 
+    {
+        if (!adjacency_view_valid_) 
+        {
+            adjacency_view_.assign(nodes_.size(), std::vector<GraphEdge>());
+            for (size_t i = 0; i < nodes_.size(); ++i) 
+            {
+                int node = static_cast<int>(i);
+                NeighborRange row = get_row(node);
+                adjacency_view_[i].reserve(row.count);
+                for (size_t k = 0; k < row.count; ++k) 
+                {
+                    adjacency_view_[i].emplace_back(node, row.targets[k], row.weights[k]);
+                }
+            }
+            adjacency_view_valid_ = true;
+        }
+        return adjacency_view_;
+    }
+
+    void VisibilityGraph::assemble_csr(const std::vector<GraphEdge>& pairs) 
+    {
+        // Counting pass, then one fill pass in (from, to) order: each row receives its lower
+        // neighbours before its higher ones, so rows come out sorted by target.
+        offsets_.assign(nodes_.size() + 1, 0);
+        for (const auto& edge : pairs) 
+        {
+            ++offsets_[edge.from_node + 1];
+            ++offsets_[edge.to_node + 1];
+        }
+        for (size_t i = 0; i < nodes_.size(); ++i) 
+        {
+            offsets_[i + 1] += offsets_[i];
+        }
+        targets_.resize(offsets_.back());
+        weights_.resize(offsets_.back());
+        std::vector<size_t>& cursor = cursor_scratch_;
+        cursor.assign(offsets_.begin(), offsets_.end() - 1);
+        for (const auto& edge : pairs) 
+        {
+            size_t forward = cursor[edge.from_node]++;
+            targets_[forward] = edge.to_node;
+            weights_[forward] = edge.weight;
+            size_t backward = cursor[edge.to_node]++;
+            targets_[backward] = edge.from_node;
+            weights_[backward] = edge.weight;
+        }
+        if (projection_) 
+        {
+            MARINE_NAV_PHASE("geodesic_weights");
+            for (size_t i = 0; i < nodes_.size(); ++i) 
+            {
+                apply_geodesic_weights(static_cast<int>(i), offsets_[i], offsets_[i + 1]);
+            }
+        }
+        row_offsets_ = offsets_.data();
+        row_targets_ = targets_.data();
+        row_weights_ = weights_.data();
+        row_entry_count_ = targets_.size();
+    }
+
+    void VisibilityGraph::build_edges_serial(const std::vector<Segment>& segments) 
+    {
+        std::vector<GraphEdge>& pairs = edge_scratch_;
+        pairs.clear();
         for (size_t i = 0; i < nodes_.size(); ++i) 
         {
             for (size_t j = i + 1; j < nodes_.size(); ++j) 
@@ -23,34 +293,129 @@ namespace marine_nav
                 if (can_connect_nodes(nodes_[i], nodes_[j], segments)) 
                 {
                     double distance = geometry_engine_.calculate_distance(nodes_[i].point, nodes_[j].point);
-                    adjacency_list_[i].emplace_back(i, j, distance);
-                    adjacency_list_[j].emplace_back(j, i, distance);
+                    pairs.emplace_back(i, j, distance);
                 }
             }
         }
+        assemble_csr(pairs);
+    }
+
+    void VisibilityGraph::build_edges_parallel(const std::vector<Segment>& segments) 
+    {
+        if (!thread_pool_) 
+        {
+            thread_pool_ = std::make_unique<ThreadPool>(thread_count_);
+        }
+        size_t workers = thread_pool_->size();
+        // Every worker shares geometry_engine_: the native kernels only read the prepared arrays, and
+        // GEOS queries run on the worker's own context against the read-only prepared lines.
+        std::vector<std::vector<GraphEdge>>& worker_edges = worker_edges_;
+        worker_edges.resize(workers);
+        for (auto& edges : worker_edges) 
+        {
+            edges.clear();
+        }
+        thread_pool_->parallel_for(nodes_.size(), 4, [&](size_t begin, size_t end, size_t worker) 
+        {
+            std::vector<GraphEdge>& edges = worker_edges[worker];
+            for (size_t i = begin; i < end; ++i) 
+            {
+                for (size_t j = i + 1; j < nodes_.size(); ++j) 
+                {
+                    if (can_connect_nodes(nodes_[i], nodes_[j], segments, geometry_engine_)) 
+                    {
+                        edges.emplace_back(i, j, geometry_engine_.calculate_distance(nodes_[i].point, nodes_[j].point));
+                    }
+                }
+            }
+        });
+        // Assemble in (from, to) order so every row matches the serial build exactly.
+        std::vector<GraphEdge>& merged = edge_scratch_;
+        merged.clear();
+        size_t total = 0;
+        for (const auto& edges : worker_edges) 
+        {
+            total += edges.size();
+        }
+        merged.reserve(total);
+        for (auto& edges : worker_edges) 
+        {
+            merged.insert(merged.end(), edges.begin(), edges.end());
+        }
+        std::sort(merged.begin(), merged.end(), [](const GraphEdge& a, const GraphEdge& b) 
+        {
+            return a.from_node != b.from_node ? a.from_node < b.from_node : a.to_node < b.to_node;
+        });
+        assemble_csr(merged);
     }
 
     bool VisibilityGraph::can_connect_nodes(const GraphNode& from, const GraphNode& to, const std::vector<Segment>& segments) const 
     {
+        return can_connect_nodes(from, to, segments, geometry_engine_);
+    }
+
+    bool VisibilityGraph::can_connect_nodes(const GraphNode& from, const GraphNode& to, const std::vector<Segment>& segments, const GeometryEngine& engine) const 
+    {
+        MARINE_NAV_COUNT(CanConnectCalls);
         if (!respects_ordering_constraint(from, to)) 
         {
+            MARINE_NAV_COUNT(RejectedOrdering);
             return false;
         }
+        if (fused_constraints_ && engine.get_intersection_backend() == IntersectionBackend::Native) 
+        {
+            // A pair is rejected for the first segment that fails either check, so the two rejection
+            // counters split differently from the staged order below; their sum is the same.
+            switch (engine.check_constraints(from.point, to.point, segments, std::max(from.segment_order, to.segment_order))) 
+            {
+                case ConstraintFailure::Orientation:
+                    MARINE_NAV_COUNT(RejectedOrientation);
+                    return false;
+                case ConstraintFailure::Visibility:
+                    MARINE_NAV_COUNT(RejectedVisibility);
+                    return false;
+                default:
+                    return true;
+            }
+        }
         if (!respects_orientation_constraint(from, to, segments)) 
         {
+            MARINE_NAV_COUNT(RejectedOrientation);
             return false;
         }
         int current_order = std::max(from.segment_order, to.segment_order);
-        if (!geometry_engine_.is_visible(from.point, to.point, segments, current_order)) 
+        if (!engine.is_visible(from.point, to.point, segments, current_order)) 
         {
+            MARINE_NAV_COUNT(RejectedVisibility);
             return false;
         }
         return true;
     }
 
+    bool VisibilityGraph::ordering_allows(const GraphNode& from, const GraphNode& to) 
+    {
+        return from.segment_order <= to.segment_order || to.segment_order == INT_MAX;
+    }
+
+    bool VisibilityGraph::segment_blocks(const GraphNode& from, const GraphNode& to, const Segment& segment) 
+    {
+        // Orientation (checked for every segment by is_visible, so it subsumes the later-segments
+        // check of respects_orientation_constraint), then the crossing test for later segments.
+        double cross_left = IntersectionKernel::orientation(from.point.x, from.point.y, to.point.x, to.point.y, segment.left.x, segment.left.y);
+        double cross_right = IntersectionKernel::orientation(from.point.x, from.point.y, to.point.x, to.point.y, segment.right.x, segment.right.y);
+        if (cross_left <= 0 || cross_right >= 0) 
+        {
+            return true;
+        }
+        int current_order = std::max(from.segment_order, to.segment_order);
+        return segment.order > current_order 
+            && IntersectionKernel::segments_intersect(from.point.x, from.point.y, to.point.x, to.point.y, 
+                                                      segment.left.x, segment.left.y, segment.right.x, segment.right.y);
+    }
+
     bool VisibilityGraph::respects_ordering_constraint(const GraphNode& from, const GraphNode& to) const 
     {
-        if (from.segment_order > to.segment_order && to.segment_order != INT_MAX) 
+        if (!ordering_allows(from, to)) 
         {
             return false;
         }
@@ -74,14 +439,12 @@ namespace marine_nav
             {
                 continue;
             }
-            double dx = to.point.x - from.point.x;
-            double dy = to.point.y - from.point.y;
-            double cross_left = dx * (segment.left.y - from.point.y) - dy * (segment.left.x - from.point.x);
+            double cross_left = IntersectionKernel::orientation(from.point.x, from.point.y, to.point.x, to.point.y, segment.left.x, segment.left.y);
             if (cross_left <= 0) 
             { 
                 return false;
             }
-            double cross_right = dx * (segment.right.y - from.point.y) - dy * (segment.right.x - from.point.x);
+            double cross_right = IntersectionKernel::orientation(from.point.x, from.point.y, to.point.x, to.point.y, segment.right.x, segment.right.y);
             if (cross_right >= 0) 
             { 
                 return false;
@@ -91,10 +454,16 @@ namespace marine_nav
     }
 
     int VisibilityGraph::find_node_index(const std::string& label) const 
+    {
+        uint32_t label_id = LabelTable::global().find(label);
+        return label_id == LabelTable::kNotFound ? -1 : find_node_index(label_id);
+    }
+
+    int VisibilityGraph::find_node_index(uint32_t label_id) const 
     {
         for (size_t i = 0; i < nodes_.size(); ++i) 
         {
-            if (nodes_[i].point.label == label) 
+            if (nodes_[i].point.label_id == label_id) 
             {
                 return static_cast<int>(i);
             }
@@ -109,21 +478,22 @@ namespace marine_nav
         for (size_t i = 0; i < nodes_.size(); ++i) 
         {
             const auto& node = nodes_[i];
-            std::cout << "  " << i << ": " << node.point.label 
+            std::cout << "  " << i << ": " << node.point.label() 
                       << " (" << node.point.x << ", " << node.point.y << ")"
                       << " order=" << node.segment_order
                       << " left=" << (node.is_left ? "true" : "false") << "\n";
         }
         std::cout << "\nEdges:\n";
-        for (size_t i = 0; i < adjacency_list_.size(); ++i) 
+        for (size_t i = 0; i < nodes_.size(); ++i) 
         {
-            for (const auto& edge : adjacency_list_[i]) 
+            NeighborRange row = get_row(static_cast<int>(i));
+            for (size_t k = 0; k < row.count; ++k) 
             {
-                if (edge.from_node < edge.to_node) 
+                if (static_cast<int>(i) < row.targets[k]) 
                 { 
-                    std::cout << "  " << nodes_[edge.from_node].point.label 
-                              << " -> " << nodes_[edge.to_node].point.label
-                              << " (weight: " << edge.weight << ")\n";
+                    std::cout << "  " << nodes_[i].point.label() 
+                              << " -> " << nodes_[row.targets[k]].point.label()
+                              << " (weight: " << row.weights[k] << ")\n";
                 }
             }
         }
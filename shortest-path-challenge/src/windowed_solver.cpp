@@ -0,0 +1,312 @@
+#include "windowed_solver.h"
+#include "metrics.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+namespace marine_nav
+{
+    // One window's nodes in layer order, as graph indices. Start is layer -1 and end is the layer
+    // after the last gateway.
+    struct WindowedSolver::Window
+    {
+        std::vector<int> nodes;
+        std::vector<int> layer;
+        std::vector<size_t> next_layer;   // first position of a strictly later layer
+        std::vector<size_t> entries;      // positions of the band shared with the previous window, or start
+        std::vector<size_t> exits;        // positions of the band shared with the next window, or end
+    };
+
+    WindowedSolver::WindowedSolver(VisibilityGraph& graph)
+        : graph_(graph), window_(256), overlap_(16), thread_count_(1), window_count_(0), pairs_evaluated_(0),
+          error_bound_(0.0) {}
+
+    void WindowedSolver::set_thread_count(size_t thread_count)
+    {
+        thread_count = ThreadPool::resolve_thread_count(thread_count);
+        if (thread_count != thread_count_)
+        {
+            thread_pool_.reset();
+        }
+        thread_count_ = thread_count;
+    }
+
+    void WindowedSolver::set_window(size_t window, size_t overlap)
+    {
+        if (overlap == 0 || window < 2 * overlap)
+        {
+            throw std::invalid_argument("Windows need an overlap of at least 1 gateway and at least twice the overlap in size");
+        }
+        window_ = window;
+        overlap_ = overlap;
+    }
+
+    WindowedSolver::Window WindowedSolver::make_window(size_t first_layer, size_t last_layer, const std::vector<std::vector<int>>& layers) const
+    {
+        size_t layer_count = layers.size();
+        bool opens = first_layer == 0;
+        bool closes = last_layer == layer_count;
+        Window window;
+        if (opens)
+        {
+            window.nodes.push_back(0);
+            window.layer.push_back(-1);
+        }
+        for (size_t l = first_layer; l < last_layer; ++l)
+        {
+            for (int node : layers[l])
+            {
+                window.nodes.push_back(node);
+                window.layer.push_back(static_cast<int>(l));
+            }
+        }
+        if (closes)
+        {
+            window.nodes.push_back(static_cast<int>(graph_.get_node_count()) - 1);
+            window.layer.push_back(static_cast<int>(layer_count));
+        }
+        size_t n = window.nodes.size();
+        window.next_layer.assign(n, n);
+        for (size_t p = n; p-- > 0;)
+        {
+            if (p + 1 < n)
+            {
+                window.next_layer[p] = window.layer[p + 1] > window.layer[p] ? p + 1 : window.next_layer[p + 1];
+            }
+        }
+        for (size_t p = 0; p < n; ++p)
+        {
+            int layer = window.layer[p];
+            if (opens ? layer == -1 : layer < static_cast<int>(first_layer + overlap_))
+            {
+                window.entries.push_back(p);
+            }
+            if (closes ? layer == static_cast<int>(layer_count) : layer >= static_cast<int>(last_layer - overlap_))
+            {
+                window.exits.push_back(p);
+            }
+        }
+        return window;
+    }
+
+    size_t WindowedSolver::sweep(const Window& window, size_t source, std::vector<double>& distances, std::vector<int>& previous,
+                                 std::vector<signed char>& pair_cache) const
+    {
+        // The same forward relaxation as ShortestPathSolver::solve_layered, confined to the window. Pair
+        // results are cached per window, so sweeps from the other band nodes reuse them.
+        const double infinity = std::numeric_limits<double>::infinity();
+        const GeometryEngine& engine = graph_.get_geometry_engine();
+        size_t n = window.nodes.size();
+        distances.assign(n, infinity);
+        previous.assign(n, -1);
+        distances[source] = 0.0;
+        size_t evaluated = 0;
+        for (size_t p = source; p < n; ++p)
+        {
+            if (distances[p] == infinity)
+            {
+                continue;
+            }
+            const GraphNode& from = graph_.get_node(window.nodes[p]);
+            for (size_t q = window.next_layer[p]; q < n; ++q)
+            {
+                signed char connected = pair_cache.empty() ? -1 : pair_cache[p * n + q];
+                const GraphNode& to = graph_.get_node(window.nodes[q]);
+                if (connected < 0)
+                {
+                    // Pairs are always tested lower graph index first, as in the full graph.
+                    connected = window.nodes[p] < window.nodes[q] ? graph_.can_connect(from, to, engine) : graph_.can_connect(to, from, engine);
+                    ++evaluated;
+                    if (!pair_cache.empty())
+                    {
+                        pair_cache[p * n + q] = connected;
+                    }
+                }
+                if (!connected)
+                {
+                    continue;
+                }
+                double candidate = distances[p] + graph_.edge_weight(window.nodes[p], window.nodes[q]);
+                if (candidate < distances[q])
+                {
+                    distances[q] = candidate;
+                    previous[q] = static_cast<int>(p);
+                }
+            }
+        }
+        return evaluated;
+    }
+
+    PathResult WindowedSolver::solve(const std::vector<Segment>& segments, const Point& start, const Point& end)
+    {
+        MARINE_NAV_PHASE("windowed_solve");
+        const double infinity = std::numeric_limits<double>::infinity();
+        PathResult result;
+        graph_.build_lazy(segments, start, end);
+        int end_idx = static_cast<int>(graph_.get_node_count()) - 1;
+        // Gateway nodes grouped into layers by segment_order.
+        std::vector<int> gateway_nodes;
+        for (int node = 1; node < end_idx; ++node)
+        {
+            gateway_nodes.push_back(node);
+        }
+        std::stable_sort(gateway_nodes.begin(), gateway_nodes.end(), [this](int a, int b)
+        {
+            return graph_.get_node(a).segment_order < graph_.get_node(b).segment_order;
+        });
+        std::vector<std::vector<int>> layers;
+        for (size_t i = 0; i < gateway_nodes.size(); ++i)
+        {
+            if (i == 0 || graph_.get_node(gateway_nodes[i]).segment_order != graph_.get_node(gateway_nodes[i - 1]).segment_order)
+            {
+                layers.emplace_back();
+            }
+            layers.back().push_back(gateway_nodes[i]);
+        }
+        size_t step = window_ - overlap_;
+        window_count_ = layers.size() <= window_ ? 1 : 1 + (layers.size() - window_ + step - 1) / step;
+        if (!thread_pool_)
+        {
+            thread_pool_ = std::make_unique<ThreadPool>(thread_count_);
+        }
+        ThreadPool& pool = *thread_pool_;
+        struct Scratch
+        {
+            std::vector<double> distances;
+            std::vector<signed char> pair_cache;
+        };
+        std::vector<Scratch> scratch(pool.size());
+        std::atomic<size_t> pairs(0);
+        std::atomic<size_t> settled(0);
+        // Windows are tabulated a pool's worth at a time and folded into the band distances straight
+        // away, so only the current batch's tables are alive. Each sweep's predecessors are kept for the
+        // route, but only while some exit of its window still comes from that entry.
+        std::vector<double> band(1, 0.0);
+        std::vector<std::vector<int>> choice(window_count_);   // per window and exit: the entry it came from
+        std::vector<std::vector<std::vector<int>>> trails(window_count_);   // per window and entry: predecessors
+        for (size_t batch_begin = 0; batch_begin < window_count_; batch_begin += pool.size())
+        {
+            size_t batch_end = std::min(batch_begin + pool.size(), window_count_);
+            std::vector<std::vector<double>> tables(batch_end - batch_begin);
+            std::vector<size_t> exit_counts(batch_end - batch_begin);
+            pool.parallel_for(batch_end - batch_begin, 1, [&](size_t begin, size_t end, size_t worker)
+            {
+                Scratch& local = scratch[worker];
+                for (size_t i = begin; i < end; ++i)
+                {
+                    size_t first_layer = (batch_begin + i) * step;
+                    Window window = make_window(first_layer, std::min(first_layer + window_, layers.size()), layers);
+                    size_t n = window.nodes.size();
+                    local.pair_cache.assign(n * n, -1);
+                    std::vector<double>& table = tables[i];
+                    table.assign(window.entries.size() * window.exits.size(), infinity);
+                    exit_counts[i] = window.exits.size();
+                    std::vector<std::vector<int>>& kept = trails[batch_begin + i];
+                    kept.resize(window.entries.size());
+                    for (size_t e = 0; e < window.entries.size(); ++e)
+                    {
+                        pairs += sweep(window, window.entries[e], local.distances, kept[e], local.pair_cache);
+                        settled += std::count_if(local.distances.begin(), local.distances.end(), [infinity](double d) { return d != infinity; });
+                        for (size_t x = 0; x < window.exits.size(); ++x)
+                        {
+                            table[e * window.exits.size() + x] = local.distances[window.exits[x]];
+                        }
+                    }
+                }
+            });
+            for (size_t i = 0; i < tables.size(); ++i)
+            {
+                size_t exits = exit_counts[i];
+                std::vector<double> next(exits, infinity);
+                std::vector<int>& chosen = choice[batch_begin + i];
+                chosen.assign(exits, -1);
+                for (size_t e = 0; e < band.size(); ++e)
+                {
+                    if (band[e] == infinity)
+                    {
+                        continue;
+                    }
+                    for (size_t x = 0; x < exits; ++x)
+                    {
+                        double candidate = band[e] + tables[i][e * exits + x];
+                        if (candidate < next[x])
+                        {
+                            next[x] = candidate;
+                            chosen[x] = static_cast<int>(e);
+                        }
+                    }
+                }
+                band.swap(next);
+                std::vector<std::vector<int>>& kept = trails[batch_begin + i];
+                std::vector<char> used(kept.size(), 0);
+                for (int entry : chosen)
+                {
+                    if (entry >= 0)
+                    {
+                        used[entry] = 1;
+                    }
+                }
+                for (size_t e = 0; e < kept.size(); ++e)
+                {
+                    if (!used[e])
+                    {
+                        std::vector<int>().swap(kept[e]);
+                    }
+                }
+            }
+        }
+        result.nodes_settled = settled;
+        const GraphNode& start_node = graph_.get_node(0);
+        const GraphNode& end_node = graph_.get_node(end_idx);
+        double direct = graph_.can_connect(start_node, end_node, graph_.get_geometry_engine()) ? graph_.edge_weight(0, end_idx) : infinity;
+        pairs_evaluated_ = pairs + 1;
+        double windowed = band.empty() ? infinity : band[0];
+        // Every route costs at least the straight leg, which bounds what a route skipping a band could save.
+        double lower_bound = graph_.edge_weight(0, end_idx);
+        if (direct == infinity && windowed == infinity)
+        {
+            // With several windows a route that skips a band may still exist, so the bound is unknown.
+            error_bound_ = window_count_ > 1 ? infinity : 0.0;
+            std::cerr << "No path found from start to end\n";
+            return result;
+        }
+        result.found = true;
+        if (direct <= windowed)
+        {
+            error_bound_ = 0.0;
+            result.total_distance = direct;
+            result.path = {start_node.point, end_node.point};
+            return result;
+        }
+        result.total_distance = windowed;
+        error_bound_ = window_count_ > 1 ? std::max(0.0, windowed - lower_bound) : 0.0;
+        // Walk the choices back from end, following each window's kept predecessors from its exit to
+        // the entry it came from. Consecutive windows share that node, so it is taken once.
+        std::vector<int> nodes;
+        int exit = 0;
+        for (size_t k = window_count_; k-- > 0;)
+        {
+            int entry = choice[k][exit];
+            size_t first_layer = k * step;
+            Window window = make_window(first_layer, std::min(first_layer + window_, layers.size()), layers);
+            const std::vector<int>& previous = trails[k][entry];
+            int p = static_cast<int>(window.exits[exit]);
+            if (!nodes.empty())
+            {
+                p = previous[p];
+            }
+            for (; p != -1; p = previous[p])
+            {
+                nodes.push_back(window.nodes[p]);
+            }
+            exit = entry;
+        }
+        for (size_t i = nodes.size(); i-- > 0;)
+        {
+            result.path.push_back(graph_.get_node(nodes[i]).point);
+        }
+        return result;
+    }
+}